@@ -0,0 +1,166 @@
+/**
+ * @file match_bench.cpp
+ * @brief Time ride matching policies on synthetic pools of waiting passengers and open vehicles.
+ *
+ * The ride matcher is driven directly, one cycle at a time, through its message interface. The passenger queue
+ *  and vehicle manager it matches between are never started, so they only hold the synthetic pools, with no
+ *  routing, movement or graphics running alongside.
+ *
+ * Usage (from the build directory, like the simulation): ./match_bench [map] [pool sizes] [matches] [seed]
+ *  e.g. ./match_bench downtown-kc 1000,10000,100000 1000 1
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrent/passenger_queue.h"
+#include "concurrent/ride_matcher.h"
+#include "concurrent/vehicle_manager.h"
+#include "map_object/object_pool.h"
+#include "map_object/passenger.h"
+#include "map_object/vehicle.h"
+#include "mapping/route_model.h"
+#include "metrics/metrics.h"
+#include "routing/road_graph.h"
+#include "routing/route_planner.h"
+#include "simulation/simulation.h"
+
+namespace {
+
+// Batch matching solves an assignment over every waiting passenger and open vehicle at once (cubic time), so
+//  above MAX_BATCH_POOL, each solve takes only BATCH_WINDOW of the first in line, against their nearest vehicles
+const int MAX_BATCH_POOL = 2000;
+const int BATCH_WINDOW = 500;
+// Cycles in a row without a match before giving up, as passengers no vehicle can reach are moved back one at a time
+const int MAX_IDLE_CYCLES = 100;
+
+struct Policy {
+    std::string name;
+    std::string match_type;
+    int window_ms; // above 0 for batch matching
+};
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    std::string map = (argc > 1) ? argv[1] : "downtown-kc";
+    std::string pool_sizes = (argc > 2) ? argv[2] : "1000,10000,100000";
+    int max_matches = (argc > 3) ? std::stoi(argv[3]) : 1000;
+    unsigned seed = (argc > 4) ? std::stoul(argv[4]) : 1;
+
+    rideshare::RouteModel model(rideshare::Simulation::ReadMapData(map));
+    rideshare::RoadGraph road_graph(model);
+    auto route_planner = std::make_shared<rideshare::RoutePlanner>(road_graph);
+    if (model.Nodes().empty() || max_matches <= 0) {
+        return 1;
+    }
+    const double MAP_DIM = (std::abs(model.MaxLat() - model.MinLat()) + std::abs(model.MaxLon() - model.MinLon())) / 2.0;
+
+    std::vector<int> sizes;
+    std::stringstream size_list(pool_sizes);
+    for (std::string size; std::getline(size_list, size, ',');) {
+        sizes.emplace_back(std::stoi(size));
+    }
+    const std::vector<Policy> policies = {
+        { .name = "simple", .match_type = "simple", .window_ms = 0 },
+        { .name = "closest", .match_type = "closest", .window_ms = 0 },
+        { .name = "batch", .match_type = "closest", .window_ms = 100 },
+        { .name = "knn", .match_type = "knn", .window_ms = 0 },
+    };
+
+    for (int size : sizes) {
+        for (const Policy &policy : policies) {
+            bool windowed = policy.window_ms > 0 && size > MAX_BATCH_POOL;
+            std::cout << policy.name << " with " << size << " passengers and vehicles";
+            if (windowed) {
+                std::cout << " (solving " << BATCH_WINDOW << " at a time)";
+            }
+            std::cout << ": ";
+
+            // Same seed gives the same pools for every policy, so they can be compared
+            srand(seed);
+            auto passenger_queue = std::make_shared<rideshare::PassengerQueue>(&model, route_planner, 0, 1, 0);
+            auto vehicle_manager = std::make_shared<rideshare::VehicleManager>(&model, route_planner, 0, 1);
+            for (int i = 0; i < size; ++i) {
+                auto passenger = rideshare::MakePooled<rideshare::Passenger>(0.0);
+                passenger->SetPosition(model.GetRandomMapPosition());
+                passenger->SetDestination(model.GetRandomMapPosition());
+                passenger_queue->AddPassenger(passenger);
+                // Vehicles drive on roads, so start each at the road node nearest a random position
+                auto vehicle = rideshare::MakePooled<rideshare::Vehicle>(0.0, 1);
+                const auto &node = road_graph.Position(road_graph.NearestNode(model.GetRandomMapPosition()));
+                vehicle->SetPosition({ .x = node.x, .y = node.y });
+                vehicle_manager->AddVehicle(vehicle);
+            }
+
+            auto metrics = std::make_shared<rideshare::Metrics>(0);
+            rideshare::RideMatcher ride_matcher(passenger_queue, vehicle_manager, MAP_DIM, policy.match_type,
+                                                road_graph, 1);
+            ride_matcher.SetMetrics(metrics);
+            ride_matcher.SetMatchWindow(policy.window_ms, 0);
+            ride_matcher.SetBatchLimit(windowed ? BATCH_WINDOW : 0);
+            for (int i = 0; i < size; ++i) {
+                auto passenger = passenger_queue->NewPassengers().at(i);
+                rideshare::RideRequest request = { .position = passenger->GetPosition(),
+                                                   .destination = passenger->GetDestination(), .priority = false,
+                                                   .request_time = passenger->RequestTime(),
+                                                   .abandon_time = passenger->AbandonTime() };
+                ride_matcher.Message({ .message_code = rideshare::RideMatcher::passenger_requests_ride, .id = i,
+                                       .payload = request });
+                rideshare::VehicleOffer offer = { .position = vehicle_manager->Vehicles().at(i)->GetPosition() };
+                ride_matcher.Message({ .message_code = rideshare::RideMatcher::vehicle_requests_passenger, .id = i,
+                                       .payload = offer });
+            }
+
+            // Matches are noted to the console, so silence it while matching
+            std::streambuf *console = std::cout.rdbuf(nullptr);
+            auto start = std::chrono::steady_clock::now();
+            ride_matcher.MatchCycle();
+            std::chrono::duration<double, std::milli> first_cycle = std::chrono::steady_clock::now() - start;
+            // The first cycle also reads every request, so time matching from the next cycle on
+            metrics->TakeSeries("match_distance_m");
+            if (policy.window_ms > 0) {
+                // Let the window close, so the next cycle matches the whole pool at once
+                std::this_thread::sleep_for(std::chrono::milliseconds(policy.window_ms));
+            }
+            std::vector<double> times_us;
+            long matched = 0;
+            double distance_sum = 0.0;
+            int idle_cycles = 0;
+            while (matched < max_matches && idle_cycles < MAX_IDLE_CYCLES) {
+                start = std::chrono::steady_clock::now();
+                ride_matcher.MatchCycle();
+                std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+                times_us.emplace_back(elapsed.count());
+                rideshare::Metrics::Series distances = metrics->TakeSeries("match_distance_m");
+                idle_cycles = (distances.count == 0) ? idle_cycles + 1 : 0;
+                matched += distances.count;
+                distance_sum += distances.sum;
+            }
+            std::cout.rdbuf(console);
+
+            std::sort(times_us.begin(), times_us.end());
+            double total_us = 0.0;
+            for (double time : times_us) {
+                total_us += time;
+            }
+            std::cout << matched << " matches, " << (long)(matched / (total_us / 1e6)) << " matches/s, mean pickup "
+                      << (long)(distance_sum / std::max(matched, 1L)) << " m" << std::endl;
+            std::cout << "  cycles: p50 " << times_us[times_us.size() / 2] << " us, max " << times_us.back()
+                      << " us (first cycle, reading all requests, " << first_cycle.count() << " ms)" << std::endl;
+        }
+    }
+
+    return 0;
+}
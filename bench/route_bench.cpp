@@ -0,0 +1,197 @@
+/**
+ * @file route_bench.cpp
+ * @brief Time route planning between random map positions, without any threads or graphics, and then
+ *  each specialized routing kernel against the generic one on the same queries, and the road graph's float
+ *  coordinates against the exact double ones.
+ *
+ * Usage (from the build directory, like the simulation): ./route_bench [map] [queries] [seed]
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "map_object/map_object.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+#include "mapping/route_model.h"
+#include "routing/road_graph.h"
+#include "routing/route_kernel.h"
+#include "routing/route_planner.h"
+#include "simulation/simulation.h"
+
+// Mean microseconds per query of running a search over every query, and its cost for each
+static double TimeQueries(const std::vector<std::pair<int, int>> &node_queries, std::vector<float> &costs,
+                          const std::function<float(int, int, std::vector<int> &)> &search) {
+    std::vector<int> path_nodes;
+    costs.clear();
+    auto start = std::chrono::steady_clock::now();
+    for (const auto &[from, to] : node_queries) {
+        costs.emplace_back(search(from, to, path_nodes));
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / node_queries.size();
+}
+
+// Queries whose costs differ beyond float rounding, e.g. from a heuristic that overestimates
+static int Mismatches(const std::vector<float> &costs1, const std::vector<float> &costs2) {
+    int mismatches = 0;
+    for (size_t i = 0; i < costs1.size(); ++i) {
+        if (costs1[i] != costs2[i] && std::fabs(costs1[i] - costs2[i]) > 1e-4f * std::fabs(costs1[i])) {
+            ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+    std::string map = (argc > 1) ? argv[1] : "downtown-kc";
+    int queries = (argc > 2) ? std::stoi(argv[2]) : 1000;
+    unsigned seed = (argc > 3) ? std::stoul(argv[3]) : 1;
+
+    rideshare::RouteModel model(rideshare::Simulation::ReadMapData(map));
+    rideshare::RoadGraph road_graph(model);
+    rideshare::RoutePlanner route_planner(road_graph);
+    if (model.Nodes().empty() || queries <= 0) {
+        return 1;
+    }
+
+    // Same seed gives the same queries, so runs can be compared
+    srand(seed);
+    std::vector<double> times_us;
+    times_us.reserve(queries);
+    int found = 0;
+    long path_nodes = 0;
+    std::vector<std::pair<int, int>> node_queries; // the same queries as road nodes, for the kernels
+    std::vector<rideshare::Coordinate> positions; // start and destination of each
+    auto map_obj = std::make_shared<rideshare::MapObject>(0.0);
+    for (int i = 0; i < queries; ++i) {
+        map_obj->SetPosition(model.GetRandomMapPosition());
+        map_obj->SetDestination(model.GetRandomMapPosition());
+        map_obj->SetPath({}, {});
+        node_queries.emplace_back(road_graph.NearestNode(map_obj->GetPosition()),
+                                  road_graph.NearestNode(map_obj->GetDestination()));
+        positions.emplace_back(map_obj->GetPosition());
+        positions.emplace_back(map_obj->GetDestination());
+
+        auto start = std::chrono::steady_clock::now();
+        route_planner.AStarSearch(map_obj);
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        times_us.emplace_back(elapsed.count());
+
+        if (!map_obj->PathNodes().empty()) {
+            ++found;
+            path_nodes += map_obj->PathNodes().size();
+        }
+    }
+
+    std::sort(times_us.begin(), times_us.end());
+    double total = 0.0;
+    for (double time : times_us) {
+        total += time;
+    }
+    std::cout << "Route planning on " << map << ": " << queries << " queries, " << found << " found"
+              << ", mean path " << ((found > 0) ? path_nodes / found : 0) << " nodes" << std::endl;
+    std::cout << "  mean " << total / queries << " us, p50 " << times_us[queries / 2]
+              << " us, p95 " << times_us[(queries * 95) / 100] << " us, max " << times_us.back() << " us" << std::endl;
+
+
+    // Each specialized kernel against the generic one, over the same queries, with each cost's landmarks
+    //  built up front so only searching is timed
+    using rideshare::RouteKernels;
+    RouteKernels kernels(road_graph);
+    std::cout << "Routing kernels (mean us per query, specialized / generic):" << std::endl;
+    std::vector<float> euclidean_costs, costs, generic_costs;
+    const char *COST_NAMES[] = { "distance", "time" };
+    const char *HEURISTIC_NAMES[] = { "euclidean", "landmarks" };
+    for (int cost : { RouteKernels::distance, RouteKernels::time }) {
+        std::vector<int> warm_path;
+        auto start = std::chrono::steady_clock::now();
+        kernels.Search(cost, RouteKernels::landmarks, node_queries[0].first, node_queries[0].second, warm_path);
+        std::chrono::duration<double, std::milli> landmark_time = std::chrono::steady_clock::now() - start;
+        for (int heuristic : { RouteKernels::euclidean, RouteKernels::landmarks }) {
+            double specialized_us = TimeQueries(node_queries, costs, [&](int from, int to, std::vector<int> &path) {
+                return kernels.Search(cost, heuristic, from, to, path);
+            });
+            double generic_us = TimeQueries(node_queries, generic_costs, [&](int from, int to, std::vector<int> &path) {
+                return kernels.SearchGeneric(cost, heuristic, from, to, path);
+            });
+            if (heuristic == RouteKernels::euclidean) {
+                euclidean_costs = costs;
+            }
+            std::cout << "  " << COST_NAMES[cost] << " / " << HEURISTIC_NAMES[heuristic] << ": " << specialized_us
+                      << " / " << generic_us << " (" << generic_us / specialized_us << "x)";
+            if (heuristic == RouteKernels::landmarks) {
+                std::cout << ", landmarks built in " << landmark_time.count() << " ms";
+            }
+            std::cout << ", mismatched costs " << Mismatches(costs, generic_costs) + Mismatches(costs, euclidean_costs)
+                      << std::endl;
+        }
+    }
+
+    // Visited set policies, on shortest distance with the Euclidean heuristic
+    rideshare::DistanceCost distance_cost{road_graph};
+    std::vector<rideshare::RouteQueueEntry> open;
+    rideshare::StampedVisited stamped;
+    rideshare::HashedVisited hashed;
+    double stamped_us = TimeQueries(node_queries, costs, [&](int from, int to, std::vector<int> &path) {
+        rideshare::EuclideanHeuristic<rideshare::DistanceCost> heuristic(road_graph, distance_cost, nullptr, to);
+        return rideshare::RouteSearch(road_graph, distance_cost, heuristic, stamped, open, from, to, path);
+    });
+    double hashed_us = TimeQueries(node_queries, generic_costs, [&](int from, int to, std::vector<int> &path) {
+        rideshare::EuclideanHeuristic<rideshare::DistanceCost> heuristic(road_graph, distance_cost, nullptr, to);
+        return rideshare::RouteSearch(road_graph, distance_cost, heuristic, hashed, open, from, to, path);
+    });
+    std::cout << "Visited sets on distance / euclidean (mean us per query): stamped " << stamped_us << ", hashed "
+              << hashed_us << ", mismatched costs " << Mismatches(costs, generic_costs) << std::endl;
+
+    // Float coordinates against the exact ones: how far each point is from its node, how much further the
+    //  nearest node found is than a full scan in double finds, and whether route costs match those from
+    //  a straight line heuristic in double
+    const std::vector<rideshare::Model::Node> &nodes = model.Nodes();
+    double max_point_error = 0.0;
+    for (int n = 0; n < road_graph.NodeCount(); ++n) {
+        const auto &point = road_graph.Point(n);
+        max_point_error = std::max({ max_point_error, std::fabs(point.x - (nodes[n].x - model.MinLon())),
+                                     std::fabs(point.y - (nodes[n].y - model.MinLat())) });
+    }
+    int nearest_differs = 0;
+    double max_nearest_extra = 0.0;
+    for (const auto &position : positions) {
+        int nearest = road_graph.NearestNode(position);
+        int exact = &model.FindClosestNode(position) - nodes.data();
+        if (nearest != exact) {
+            ++nearest_differs;
+            max_nearest_extra = std::max(max_nearest_extra,
+                std::hypot(nodes[nearest].x - position.x, nodes[nearest].y - position.y) -
+                std::hypot(nodes[exact].x - position.x, nodes[exact].y - position.y));
+        }
+    }
+    rideshare::GenericHeuristic exact_heuristic;
+    TimeQueries(node_queries, generic_costs, [&](int from, int to, std::vector<int> &path) {
+        const rideshare::Model::Node &target = road_graph.Position(to);
+        exact_heuristic.bound = [&road_graph, target](int node) {
+            const rideshare::Model::Node &position = road_graph.Position(node);
+            return (float)std::hypot(position.x - target.x, position.y - target.y);
+        };
+        return rideshare::RouteSearch(road_graph, distance_cost, exact_heuristic, stamped, open, from, to, path);
+    });
+    // Roughly, as a degree of latitude is about 111 km
+    const double METERS_PER_DEGREE = 111320.0;
+    std::cout << "Float coordinates (" << sizeof(rideshare::RoadGraph::LocalPoint) << " bytes per node, against "
+              << sizeof(rideshare::Model::Node) << "): max point error " << max_point_error * METERS_PER_DEGREE
+              << " m, nearest node differs " << nearest_differs << " / " << positions.size() << " (at most "
+              << max_nearest_extra * METERS_PER_DEGREE << " m further), mismatched route costs "
+              << Mismatches(costs, generic_costs) << std::endl;
+
+    return 0;
+}
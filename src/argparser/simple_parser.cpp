@@ -25,22 +25,72 @@ std::unordered_map<std::string, std::string> SimpleParser::ParseArgs(int argc, c
             PrintHelper();
         } else if (argv[i][0] == '-' && (i+1 >= argc)) {
             MissingArgValue(argv[i]);
+        } else if (argv[i] == std::string("-a")) {
+            ParseNumericInputs(argv[i+1], "Abandon", 0, ABSOLUTE_MAX_ABANDON);
+            settings["abandon"] = argv[i+1];
+        } else if (argv[i] == std::string("-b")) {
+            ParseNumericInputs(argv[i+1], "Rebalance", 0, ABSOLUTE_MAX_REBALANCE);
+            settings["rebalance"] = argv[i+1];
+        } else if (argv[i] == std::string("-c")) {
+            ParseNumericInputs(argv[i+1], "Capacity", 1, ABSOLUTE_MAX_CAPACITY);
+            settings["capacity"] = argv[i+1];
+        } else if (argv[i] == std::string("-d")) {
+            ParseNumericInputs(argv[i+1], "Duration", 0, ABSOLUTE_MAX_DURATION);
+            settings["duration"] = argv[i+1];
+        } else if (argv[i] == std::string("-e")) {
+            ParseNumericInputs(argv[i+1], "Chain", 0, ABSOLUTE_MAX_CHAIN);
+            settings["chain"] = argv[i+1];
+        } else if (argv[i] == std::string("-f")) {
+            ParseNumericInputs(argv[i+1], "Frame Rate", ABSOLUTE_MIN_FRAME_RATE, ABSOLUTE_MAX_FRAME_RATE);
+            settings["frame_rate"] = argv[i+1];
+        } else if (argv[i] == std::string("-g")) {
+            ParseNumericInputs(argv[i+1], "Display", 0, 1);
+            settings["display"] = argv[i+1];
+        } else if (argv[i] == std::string("-i")) {
+            ParseNumericInputs(argv[i+1], "Match Window", 0, ABSOLUTE_MAX_MATCH_WINDOW);
+            settings["match_window"] = argv[i+1];
+        } else if (argv[i] == std::string("-j")) {
+            ParseNumericInputs(argv[i+1], "Priority", 0, 100);
+            settings["priority"] = argv[i+1];
+        } else if (argv[i] == std::string("-k")) {
+            settings["patience"] = ParsePatience(argv[i+1]);
+        } else if (argv[i] == std::string("-l")) {
+            ParseNumericInputs(argv[i+1], "Routes", 0, 1);
+            settings["routes"] = argv[i+1];
         } else if (argv[i] == std::string("-m")) {
             settings["map"] = argv[i+1];
+        } else if (argv[i] == std::string("-n")) {
+            ParseNumericInputs(argv[i+1], "Road Network", 0, 1);
+            settings["network"] = argv[i+1];
+        } else if (argv[i] == std::string("-o")) {
+            settings["output"] = argv[i+1];
         } else if (argv[i] == std::string("-p")) {
             ParseNumericInputs(argv[i+1], "Passengers", ABSOLUTE_MIN_OBJECTS, ABSOLUTE_MAX_OBJECTS);
             settings["passengers"] = argv[i+1];
+        } else if (argv[i] == std::string("-q")) {
+            ParseNumericInputs(argv[i+1], "Window Requests", 0, ABSOLUTE_MAX_OBJECTS);
+            settings["window_requests"] = argv[i+1];
         } else if (argv[i] == std::string("-r")) {
             ParseNumericInputs(argv[i+1], "Wait Range", ABSOLUTE_MIN_WAIT_RANGE, ABSOLUTE_MAX_OBJECTS);
             settings["wait_range"] = argv[i+1];
+        } else if (argv[i] == std::string("-s")) {
+            settings["shared_memory"] = argv[i+1];
         } else if (argv[i] == std::string("-t")) {
             settings["match"] = ParseMatchType(argv[i+1]);
+        } else if (argv[i] == std::string("-u")) {
+            ParseNumericInputs(argv[i+1], "Market", 0, ABSOLUTE_MAX_MARKET);
+            settings["market"] = argv[i+1];
         } else if (argv[i] == std::string("-v")) {
             ParseNumericInputs(argv[i+1], "Vehicles", ABSOLUTE_MIN_OBJECTS, ABSOLUTE_MAX_OBJECTS);
             settings["vehicles"] = argv[i+1];
         } else if (argv[i] == std::string("-w")) {
             ParseNumericInputs(argv[i+1], "Wait", ABSOLUTE_MIN_WAIT, ABSOLUTE_MAX_OBJECTS);
             settings["wait"] = argv[i+1];
+        } else if (argv[i] == std::string("-x")) {
+            settings["export"] = argv[i+1];
+        } else if (argv[i] == std::string("-z")) {
+            ParseNumericInputs(argv[i+1], "Zones", 1, ABSOLUTE_MAX_ZONES);
+            settings["zones"] = argv[i+1];
         }
     }
 
@@ -58,13 +108,26 @@ std::string SimpleParser::ParseMatchType(std::string input_match) {
         ch = tolower(ch);
     }
     // Make sure it is a valid type
-    if (input_match != "closest" && input_match != "simple") {
+    if (input_match != "closest" && input_match != "simple" && input_match != "knn") {
         std::cout << "Invalid match type given." << std::endl;
         PrintHelper();
     }
     return input_match;
 }
 
+std::string SimpleParser::ParsePatience(std::string input_patience) {
+    // Make lowercase
+    for (auto& ch : input_patience) {
+        ch = tolower(ch);
+    }
+    // Make sure it is a valid distribution
+    if (input_patience != "fixed" && input_patience != "exponential" && input_patience != "uniform") {
+        std::cout << "Invalid patience distribution given." << std::endl;
+        PrintHelper();
+    }
+    return input_patience;
+}
+
 void SimpleParser::ParseNumericInputs(std::string max_objects, std::string name, int min, int max) {
     // Check that it is a number
     try {
@@ -82,19 +145,53 @@ void SimpleParser::ParseNumericInputs(std::string max_objects, std::string name,
 
 void SimpleParser::PrintHelper() {
     std::cout << "Rideshare Simulation - Valid Arguments" << std::endl;
+    std::cout << "-a : Average seconds a passenger waits for a match before giving up, see -k (0 waits forever).  Max: "
+      << ABSOLUTE_MAX_ABANDON << "  Default: " << DEFAULT_ABANDON << std::endl;
+    std::cout << "-b : Seconds between sending idle vehicles toward forecast demand (0 never does).  Max: "
+      << ABSOLUTE_MAX_REBALANCE << "  Default: " << DEFAULT_REBALANCE << std::endl;
+    std::cout << "-c : Vehicle capacity; above 1, rides are pooled along the way.  Min: 1  Max: "
+      << ABSOLUTE_MAX_CAPACITY << "  Default: " << DEFAULT_CAPACITY << std::endl;
+    std::cout << "-d : Seconds to run for before exiting, headless only (0 runs until stopped).  Max: "
+      << ABSOLUTE_MAX_DURATION << "  Default: " << DEFAULT_DURATION << std::endl;
+    std::cout << "-e : Milliseconds before a drop off to offer the vehicle for its next passenger (0 never does).  Max: "
+      << ABSOLUTE_MAX_CHAIN << "  Default: " << DEFAULT_CHAIN << std::endl;
+    std::cout << "-f : Frame rate, in simulation time, to record output at.  Min: "
+      << ABSOLUTE_MIN_FRAME_RATE << "  Max: " << ABSOLUTE_MAX_FRAME_RATE << "  Default: " << DEFAULT_FRAME_RATE << std::endl;
+    std::cout << "-g : Display graphics window (1), or only draw offscreen for recording (0).  Default: "
+      << DEFAULT_DISPLAY << std::endl;
     std::cout << "-h : Display this helper text. Program will exit." << std::endl;
+    std::cout << "-i : Milliseconds to gather requests before matching them all at once (0 matches each right away).  Max: "
+      << ABSOLUTE_MAX_MATCH_WINDOW << "  Default: " << DEFAULT_MATCH_WINDOW << std::endl;
+    std::cout << "-j : Percent of passengers in the priority class, served as if already waiting 30 seconds.  Min: 0  Max: 100  Default: "
+      << DEFAULT_PRIORITY << std::endl;
+    std::cout << "-k : Distribution of passenger patience around -a, either 'fixed', 'exponential' or 'uniform'.  Default: "
+      << DEFAULT_PATIENCE << std::endl;
+    std::cout << "-l : Draw the remaining route of each vehicle (1), or not (0).  Default: "
+      << DEFAULT_ROUTES << std::endl;
     std::cout << "-m : Map data file and image name, in /data dir.  Default: "
       << DEFAULT_MAP << std::endl;
+    std::cout << "-n : Draw the road network, colored by congestion (1), or not (0).  Default: "
+      << DEFAULT_NETWORK << std::endl;
+    std::cout << "-o : Record to a video file, or numbered images if ending in '.png'.  Default: none" << std::endl;
     std::cout << "-p : Max passengers in queue.  Min: 0  Max: "
       << ABSOLUTE_MAX_OBJECTS << "  Default: " << DEFAULT_MAX_OBJECTS << std::endl;
+    std::cout << "-q : Requests that close the match window early, if enabled (0 for no limit).  Min: 0  Max: "
+      << ABSOLUTE_MAX_OBJECTS << "  Default: " << DEFAULT_WINDOW_REQUESTS << std::endl;
     std::cout << "-r : Range, on top of min, to wait to generate passenger.  Min: "
       << ABSOLUTE_MIN_WAIT_RANGE << "  Default: " << DEFAULT_WAIT_RANGE << std::endl;
-    std::cout << "-t : Match type, either 'closest' or 'simple'.  Default: "
+    std::cout << "-s : Write agent state to a shared memory ring with this name (e.g. '/rideshare').  Default: none"
+      << std::endl;
+    std::cout << "-t : Match type, either 'closest', 'simple' or 'knn'.  Default: "
       << DEFAULT_MATCH_TYPE << std::endl;
+    std::cout << "-u : Seconds between market updates of surge prices and fleet size (0 for a fixed fleet).  Max: "
+      << ABSOLUTE_MAX_MARKET << "  Default: " << DEFAULT_MARKET << std::endl;
     std::cout << "-v : Max vehicles driving.  Min: 0  Max: "
       << ABSOLUTE_MAX_OBJECTS << "  Default: " << DEFAULT_MAX_OBJECTS << std::endl;
     std::cout << "-w : Minimum wait time to generate next waiting passenger.  Min: "
       << ABSOLUTE_MIN_WAIT << "  Default: " << DEFAULT_MIN_WAIT << std::endl;
+    std::cout << "-x : Stream agent state to viewers over a Unix domain socket at this path.  Default: none" << std::endl;
+    std::cout << "-z : Zones per side of the map, each matched on its own thread.  Min: 1  Max: "
+      << ABSOLUTE_MAX_ZONES << "  Default: " << DEFAULT_ZONES << std::endl;
     // Do not continue the program
     exit(0);
 }
@@ -103,12 +200,30 @@ std::unordered_map<std::string, std::string> SimpleParser::SetDefaults() {
     std::unordered_map<std::string, std::string> settings;
 
     // Place all default values
+    settings.emplace("abandon", DEFAULT_ABANDON);
+    settings.emplace("capacity", DEFAULT_CAPACITY);
+    settings.emplace("chain", DEFAULT_CHAIN);
+    settings.emplace("display", DEFAULT_DISPLAY);
+    settings.emplace("duration", DEFAULT_DURATION);
+    settings.emplace("export", "");
+    settings.emplace("frame_rate", DEFAULT_FRAME_RATE);
     settings.emplace("map", DEFAULT_MAP);
+    settings.emplace("market", DEFAULT_MARKET);
     settings.emplace("match", DEFAULT_MATCH_TYPE);
+    settings.emplace("match_window", DEFAULT_MATCH_WINDOW);
+    settings.emplace("network", DEFAULT_NETWORK);
+    settings.emplace("output", "");
     settings.emplace("passengers", DEFAULT_MAX_OBJECTS);
+    settings.emplace("patience", DEFAULT_PATIENCE);
+    settings.emplace("priority", DEFAULT_PRIORITY);
+    settings.emplace("rebalance", DEFAULT_REBALANCE);
+    settings.emplace("routes", DEFAULT_ROUTES);
+    settings.emplace("shared_memory", "");
     settings.emplace("vehicles", DEFAULT_MAX_OBJECTS);
     settings.emplace("wait", DEFAULT_MIN_WAIT);
     settings.emplace("wait_range", DEFAULT_WAIT_RANGE);
+    settings.emplace("window_requests", DEFAULT_WINDOW_REQUESTS);
+    settings.emplace("zones", DEFAULT_ZONES);
 
     return settings;
 }
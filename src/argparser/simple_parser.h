@@ -21,19 +21,45 @@ class SimpleParser {
   private:
     void MissingArgValue(std::string arg);
     std::string ParseMatchType(std::string input_match);
+    std::string ParsePatience(std::string input_patience);
     void ParseNumericInputs(std::string max_objects, std::string name, int min, int max);
     void PrintHelper();
     std::unordered_map<std::string, std::string> SetDefaults();
 
+    const std::string DEFAULT_ABANDON = "0"; // Avg. seconds waiting for a match before giving up, 0 for never
+    const std::string DEFAULT_PATIENCE = "fixed"; // Distribution of each passenger's wait before giving up
+    const std::string DEFAULT_REBALANCE = "0"; // Seconds between rebalancing idle vehicles, 0 for never
+    const std::string DEFAULT_CAPACITY = "1"; // Passengers per vehicle, so no pooling
     const std::string DEFAULT_MAP = "downtown-kc";
     const std::string DEFAULT_MATCH_TYPE = "closest";
+    const std::string DEFAULT_MATCH_WINDOW = "0"; // ms to gather requests before matching, 0 matches right away
+    const std::string DEFAULT_WINDOW_REQUESTS = "20"; // Requests that close the window early
+    const std::string DEFAULT_MARKET = "0"; // Seconds between market updates, 0 for no market
     const std::string DEFAULT_MAX_OBJECTS = "10"; // Vehicles & Passengers
     const std::string DEFAULT_MIN_WAIT = "3"; // Wait for next generation
     const std::string DEFAULT_WAIT_RANGE = "2"; // Range of wait time above min
+    const std::string DEFAULT_DISPLAY = "1"; // Show the graphics window
+    const std::string DEFAULT_DURATION = "0"; // Run headless until stopped
+    const std::string DEFAULT_CHAIN = "0"; // ms before a drop off to offer a vehicle for its next passenger, 0 for never
+    const std::string DEFAULT_FRAME_RATE = "30"; // Recording frames per second of simulation time
+    const std::string DEFAULT_NETWORK = "0"; // Don't draw the road network
+    const std::string DEFAULT_ROUTES = "0"; // Don't draw vehicle routes
+    const std::string DEFAULT_PRIORITY = "0"; // Percent of passengers in the priority class
+    const std::string DEFAULT_ZONES = "1"; // Zones per side of the map, each matched on its own thread
+    const int ABSOLUTE_MAX_CAPACITY = 8;
+    const int ABSOLUTE_MAX_ABANDON = 3600; // One hour
+    const int ABSOLUTE_MAX_MARKET = 3600;
+    const int ABSOLUTE_MAX_REBALANCE = 3600; // One hour
+    const int ABSOLUTE_MAX_CHAIN = 10000; // Ten seconds
+    const int ABSOLUTE_MAX_ZONES = 4; // Per side, so 16 zones
+    const int ABSOLUTE_MAX_MATCH_WINDOW = 10000; // Ten seconds
+    const int ABSOLUTE_MAX_DURATION = 86400; // One day
     const int ABSOLUTE_MAX_OBJECTS = 100; // Don't allow higher
     const int ABSOLUTE_MIN_OBJECTS = 0; // Don't allow lower
     const int ABSOLUTE_MIN_WAIT = 1;
     const int ABSOLUTE_MIN_WAIT_RANGE = 0;
+    const int ABSOLUTE_MIN_FRAME_RATE = 1;
+    const int ABSOLUTE_MAX_FRAME_RATE = 60;
 };
 
 }  // namespace rideshare
@@ -0,0 +1,34 @@
+/**
+ * @file agent_snapshot.cpp
+ * @brief Implementation of publishing and reading agent snapshots between threads.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "agent_snapshot.h"
+
+#include <mutex>
+#include <utility>
+
+namespace rideshare {
+
+void SnapshotBuffer::Publish(AgentSnapshot &snapshot) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    std::swap(latest_, snapshot);
+}
+
+bool SnapshotBuffer::Read(AgentSnapshot &snapshot) {
+    std::lock_guard<std::mutex> lck(mutex_);
+    if (latest_.tick == snapshot.tick) {
+        return false;
+    }
+    snapshot.tick = latest_.tick;
+    snapshot.time = latest_.time;
+    // assign re-uses the reader's existing capacity
+    snapshot.agents.assign(latest_.agents.begin(), latest_.agents.end());
+    snapshot.path_nodes.assign(latest_.path_nodes.begin(), latest_.path_nodes.end());
+    return true;
+}
+
+}  // namespace rideshare
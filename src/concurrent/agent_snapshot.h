@@ -0,0 +1,70 @@
+/**
+ * @file agent_snapshot.h
+ * @brief Compact per-tick copies of agent state, published by the simulation for readers like the renderer.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef AGENT_SNAPSHOT_H_
+#define AGENT_SNAPSHOT_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+// Kind of agent, which decides how it is drawn
+enum AgentKind : uint8_t {
+    vehicle_agent,
+    waiting_passenger,
+    walking_passenger,
+    riding_passenger,
+};
+
+// Plain copy of everything needed to show a single agent, with no pointers back into the simulation
+struct AgentState {
+    int id;
+    uint8_t kind;       // AgentKind
+    uint8_t state;      // VehicleState or Passenger::PassengerStatus
+    uint8_t shape;      // DrawMarker at position
+    uint8_t dest_shape; // DrawMarker at destination (passengers only)
+    uint8_t blue, green, red;
+    Coordinate position;
+    Coordinate destination;
+    int edge_from; // road node indices of the path segment being driven (vehicles only), else -1
+    int edge_to;
+    int path_offset; // remaining path, as road node indices within the snapshot's path_nodes (if published)
+    int path_count;
+};
+
+// All agents held by one object (e.g. the vehicle manager) at the end of a single simulation tick
+struct AgentSnapshot {
+    long tick = 0; // increases with each publish, 0 if nothing published yet
+    std::chrono::steady_clock::time_point time;
+    std::vector<AgentState> agents;
+    std::vector<int> path_nodes; // remaining paths of any agents with them, back to back
+};
+
+// Hands the latest snapshot from a single simulation thread to any readers
+class SnapshotBuffer {
+  public:
+    // Publish a filled snapshot. It is swapped with the previous one, so the caller gets back
+    //  the older snapshot's storage to clear and re-fill next tick without allocating
+    void Publish(AgentSnapshot &snapshot);
+    // Copy the latest snapshot into the given one, if newer than the tick it already holds.
+    //  Returns whether a newer snapshot was copied
+    bool Read(AgentSnapshot &snapshot);
+
+  private:
+    AgentSnapshot latest_;
+    std::mutex mutex_; // protect latest_ while swapping in or copying out
+};
+
+}  // namespace rideshare
+
+#endif  // AGENT_SNAPSHOT_H_
@@ -9,9 +9,12 @@
 #ifndef OBJECT_HOLDER_H_
 #define OBJECT_HOLDER_H_
 
+#include <chrono>
 #include <memory>
 
+#include "agent_snapshot.h"
 #include "mapping/route_model.h"
+#include "map_object/map_object.h"
 #include "routing/route_planner.h"
 
 namespace rideshare {
@@ -23,13 +26,40 @@ class ObjectHolder {
                  int max_objects) :
       model_(model), route_planner_(route_planner), MAX_OBJECTS_(max_objects) {};
 
+    // Getters / Setters
+    // Latest published copy of the held objects' state, safe to read from other threads
+    SnapshotBuffer &Snapshots() { return snapshots_; }
+
   protected:
     virtual void GenerateNew() {};
+    // Re-fill snapshot_ with the held objects' state, then call FinishSnapshot to publish it
+    virtual void PublishSnapshot() {};
+    // Add a single object's state to snapshot_
+    void AddToSnapshot(MapObject &map_obj, AgentKind kind, int state, int shape, int dest_shape) {
+        snapshot_.agents.push_back({ .id = map_obj.Id(), .kind = kind, .state = (uint8_t)state,
+                                     .shape = (uint8_t)shape, .dest_shape = (uint8_t)dest_shape,
+                                     .blue = (uint8_t)map_obj.Blue(), .green = (uint8_t)map_obj.Green(),
+                                     .red = (uint8_t)map_obj.Red(), .position = map_obj.GetPosition(),
+                                     .destination = map_obj.GetDestination(), .edge_from = -1, .edge_to = -1,
+                                     .path_offset = 0, .path_count = 0 });
+    }
+    // Stamp and publish snapshot_, getting back older storage to re-fill next time
+    void FinishSnapshot() {
+        snapshot_.tick = ++snapshot_tick_;
+        snapshot_.time = std::chrono::steady_clock::now();
+        snapshots_.Publish(snapshot_);
+        snapshot_.agents.clear();
+        snapshot_.path_nodes.clear();
+    }
+
     const int MAX_OBJECTS_; // Set max number of objects to pause generation at
     RouteModel *model_;
     double distance_per_cycle_; // max distance to move per cycle for smooth-looking movement
     int idCnt_ = 0; // Count object ids
     std::shared_ptr<RoutePlanner> route_planner_; // Route planner to use throughout the sim
+    AgentSnapshot snapshot_; // filled by the simulation thread each cycle before publishing
+    SnapshotBuffer snapshots_;
+    long snapshot_tick_ = 0;
 };
 
 }  // namespace rideshare
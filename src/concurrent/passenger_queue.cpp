@@ -9,13 +9,16 @@
 #include "passenger_queue.h"
 
 #include <chrono>
+#include <cmath>
 #include <memory>
 #include <mutex>
 
 #include "ride_matcher.h"
 #include "simple_message.h"
 #include "mapping/route_model.h"
+#include "map_object/object_pool.h"
 #include "map_object/passenger.h"
+#include "routing/road_graph.h"
 #include "routing/route_planner.h"
 
 namespace rideshare {
@@ -38,8 +41,15 @@ void PassengerQueue::GenerateNew() {
     // Get random start and destination locations
     auto start = model_->GetRandomMapPosition();
     auto dest = model_->GetRandomMapPosition();
+    // Fewer riders will pay a higher price, e.g. only half at double
+    if (market_ != nullptr && ((double)rand() / RAND_MAX) * market_->Surge(start) > 1.0) {
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << "A new passenger was priced out by surge pricing." << std::endl;
+        return;
+    }
     // Set those to passenger
-    std::shared_ptr<Passenger> passenger = std::make_shared<Passenger>(distance_per_cycle_);
+    // Pooled, as thousands of passengers come and go
+    std::shared_ptr<Passenger> passenger = MakePooled<Passenger>(distance_per_cycle_);
     passenger->SetPosition(start);
     passenger->SetDestination(dest);
     // Set path with route planner, and verify the path between them is valid/reachable
@@ -51,14 +61,38 @@ void PassengerQueue::GenerateNew() {
         std::cout << "A new passenger with an unreachable destination from their position left." << std::endl;
         return;
     }
-    // Set id to the passenger
-    passenger->SetId(idCnt_++);
-    new_passengers_.emplace(passenger->Id(), passenger);
+    AddPassenger(passenger);
     // Output id and location of passenger requesting ride
     std::lock_guard<std::mutex> lck(mtx_);
     std::cout << "Passenger #" << idCnt_ - 1 << " requesting ride from: " << start.y << ", " << start.x << "." << std::endl;
 }
 
+void PassengerQueue::AddPassenger(std::shared_ptr<Passenger> passenger) {
+    // Set id, priority and patience to the passenger
+    passenger->SetId(idCnt_++);
+    if (rand() % 100 < priority_percent_) {
+        passenger->SetPriority(Passenger::PriorityClass::priority);
+    }
+    auto now = std::chrono::steady_clock::now();
+    passenger->SetRequestTime(now);
+    if (patience_ms_ > 0) {
+        int patience = (int)DrawPatience();
+        passenger->SetAbandonTime(now + std::chrono::milliseconds(patience));
+    }
+    new_passengers_.emplace(passenger->Id(), passenger);
+}
+
+double PassengerQueue::DrawPatience() {
+    double uniform = (double)rand() / ((double)RAND_MAX + 1.0); // in [0, 1)
+    if (patience_distribution_ == "exponential") {
+        // Most give up early, with a long tail of the very patient
+        return -patience_ms_ * std::log(1.0 - uniform);
+    } else if (patience_distribution_ == "uniform") {
+        return 2.0 * patience_ms_ * uniform;
+    }
+    return patience_ms_;
+}
+
 void PassengerQueue::Simulate() {
     // Launch WaitForRide function in a thread
     threads.emplace_back(std::thread(&PassengerQueue::WaitForRide, this));
@@ -99,14 +133,29 @@ void PassengerQueue::WaitForRide() {
         WalkPassengersToVehicles();
 
         // Request rides for passengers in queue, if not yet requested
-        for (auto passenger_pair : new_passengers_) {
+        for (const auto &passenger_pair : new_passengers_) {
             if (passenger_pair.second->GetStatus() == Passenger::PassengerStatus::no_ride_requested) {
                 RequestRide(passenger_pair.second);
             }
         }
+
+        // Let readers (e.g. graphics) see this cycle's positions
+        PublishSnapshot();
     }
 }
 
+void PassengerQueue::PublishSnapshot() {
+    for (auto & [id, passenger] : new_passengers_) {
+        AddToSnapshot(*passenger, AgentKind::waiting_passenger, passenger->GetStatus(),
+                      passenger->PassShape(), passenger->DestShape());
+    }
+    for (auto & [id, passenger] : walking_passengers_) {
+        AddToSnapshot(*passenger, AgentKind::walking_passenger, passenger->GetStatus(),
+                      passenger->PassShape(), passenger->DestShape());
+    }
+    FinishSnapshot();
+}
+
 void PassengerQueue::Message(SimpleMessage simple_message) {
     std::lock_guard<std::mutex> lck(messages_mutex_);
     // Add the message for later reading
@@ -131,6 +180,8 @@ void PassengerQueue::ReadMessages() {
             PassengerPickedUp(message.id);
         } else if (message.message_code == MsgCodes::passenger_failure) {
             PassengerFailure(message.id);
+        } else if (message.message_code == MsgCodes::passenger_abandoned) {
+            PassengerAbandoned(message.id);
         }
     }
 }
@@ -138,7 +189,11 @@ void PassengerQueue::ReadMessages() {
 void PassengerQueue::RequestRide(std::shared_ptr<Passenger> passenger) {
     passenger->SetStatus(Passenger::PassengerStatus::ride_requested);
     if (ride_matcher_ != nullptr) {
-        ride_matcher_->Message({ .message_code=RideMatcher::passenger_requests_ride, .id=passenger->Id() });
+        // Send everything needed to match and order them, as the ride matcher works from its own thread
+        RideRequest request = { .position = passenger->GetPosition(), .destination = passenger->GetDestination(),
+                                .priority = passenger->Priority() == Passenger::PriorityClass::priority,
+                                .request_time = passenger->RequestTime(), .abandon_time = passenger->AbandonTime() };
+        ride_matcher_->Message({ .message_code=RideMatcher::passenger_requests_ride, .id=passenger->Id(), .payload=request });
     }
 }
 
@@ -152,14 +207,16 @@ void PassengerQueue::RideArrived(int id) {
     walking_passengers_.emplace(id, passenger);
     new_passengers_.erase(id);
     // Vehicle will be at closest road node to passenger position
-    auto vehicle_location = model_->FindClosestNode(passenger->GetPosition());
+    const RoadGraph &graph = route_planner_->Graph();
+    Model::Node vehicle_location = graph.Position(graph.NearestNode(passenger->GetPosition()));
     passenger->SetWalkToPos(vehicle_location);
     passenger->SetStatus(Passenger::PassengerStatus::walking);
 }
 
 void PassengerQueue::PassengerAtVehicle(int id) {
     // Send the passenger to the vehicle
-    ride_matcher_->Message({ .message_code=RideMatcher::passenger_to_vehicle, .id=id });
+    PassengerHandoff handoff = { .passenger = walking_passengers_.at(id) };
+    ride_matcher_->Message({ .message_code=RideMatcher::passenger_to_vehicle, .id=id, .payload=handoff });
 }
 
 void PassengerQueue::PassengerPickedUp(int id) {
@@ -168,8 +225,13 @@ void PassengerQueue::PassengerPickedUp(int id) {
 }
 
 void PassengerQueue::PassengerFailure(int id) {
+    // Ignore any failures still on the way for a passenger already removed
+    auto found = new_passengers_.find(id);
+    if (found == new_passengers_.end()) {
+        return;
+    }
     // Check if enough failures to delete
-    auto passenger = new_passengers_.at(id);
+    auto passenger = found->second;
     bool remove = passenger->MovementFailure();
     if (remove) {
         // Notify the ride matcher
@@ -185,8 +247,21 @@ void PassengerQueue::PassengerFailure(int id) {
     }
 }
 
+void PassengerQueue::PassengerAbandoned(int id) {
+    auto found = new_passengers_.find(id);
+    if (found == new_passengers_.end()) {
+        return;
+    }
+    // Erase the passenger, and let the ride matcher know they're gone for good
+    new_passengers_.erase(found);
+    ride_matcher_->Message({ .message_code=RideMatcher::passenger_is_ineligible, .id=id });
+    // Note to console
+    std::lock_guard<std::mutex> lck(mtx_);
+    std::cout << "Passenger #" << id << " waited too long for a ride, leaving map." << std::endl;
+}
+
 void PassengerQueue::WalkPassengersToVehicles() {
-    for (auto [id, passenger] : walking_passengers_) {
+    for (const auto & [id, passenger] : walking_passengers_) {
         if (passenger->GetStatus() == Passenger::PassengerStatus::walking) {
             passenger->IncrementalMove();
             // If passenger now at ride after incremental move, send message
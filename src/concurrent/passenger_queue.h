@@ -11,6 +11,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -18,15 +19,11 @@
 #include "message_handler.h"
 #include "object_holder.h"
 #include "simple_message.h"
+#include "dispatch/market.h"
 #include "mapping/route_model.h"
 #include "map_object/passenger.h"
 #include "routing/route_planner.h"
 
-// Avoid circular includes
-namespace rideshare {
-    class RideMatcher;
-}
-
 namespace rideshare {
 
 class PassengerQueue : public ConcurrentObject, public ObjectHolder, public MessageHandler {
@@ -37,6 +34,7 @@ class PassengerQueue : public ConcurrentObject, public ObjectHolder, public Mess
         ride_arrived,
         passenger_picked_up,
         passenger_failure,
+        passenger_abandoned,
     };
 
     // Constructor / Destructor
@@ -46,7 +44,19 @@ class PassengerQueue : public ConcurrentObject, public ObjectHolder, public Mess
     // Getters / Setters
     const std::unordered_map<int, std::shared_ptr<Passenger>>& NewPassengers() { return new_passengers_; }
     const std::unordered_map<int, std::shared_ptr<Passenger>>& WalkingPassengers() { return walking_passengers_; }
-    void SetRideMatcher(std::shared_ptr<RideMatcher> ride_matcher) { ride_matcher_ = ride_matcher; }
+    // Receives RideMatcher message codes, whether a single ride matcher or a router to zones of them
+    void SetRideMatcher(std::shared_ptr<MessageHandler> ride_matcher) { ride_matcher_ = ride_matcher; }
+    // Price some new riders out where the market is surging
+    void SetMarket(std::shared_ptr<Market> market) { market_ = market; }
+    // Give each new passenger a patience to wait for a match, averaging `patience_ms` (0 waits forever), and
+    //  drawn from a `distribution` of "fixed" (all the same), "exponential" or "uniform" (0 to twice the average)
+    void SetPatience(int patience_ms, std::string distribution) { patience_ms_ = patience_ms; patience_distribution_ = distribution; }
+    // Put about `percent` of new passengers in the priority class
+    void SetPriorityShare(int percent) { priority_percent_ = percent; }
+
+    // Add a passenger already placed (e.g. synthetic demand), giving them an id, priority and patience, but
+    //  skipping the route check of generation. Only safe before Simulate, or from the queue's own thread
+    void AddPassenger(std::shared_ptr<Passenger> passenger);
 
     // Concurrent simulation
     void Simulate();
@@ -58,8 +68,12 @@ class PassengerQueue : public ConcurrentObject, public ObjectHolder, public Mess
     // Creation
     // Regularly generate more passengers
     void GenerateNew();
+    // Draw a new passenger's patience, in ms
+    double DrawPatience();
     // Handles loop cycle of generation, reading messages, requesting rides
     void WaitForRide();
+    // Publish waiting and walking passengers for readers on other threads
+    void PublishSnapshot();
 
     // Ride match handling
     // Request a ride for a given passenger
@@ -81,13 +95,19 @@ class PassengerQueue : public ConcurrentObject, public ObjectHolder, public Mess
 
     // Failure handling
     void PassengerFailure(int id);
+    // Passenger gave up waiting for a match, so remove them
+    void PassengerAbandoned(int id);
 
     // Variables
     const int MIN_WAIT_TIME_; // seconds to wait between generation attempts
     const int RANGE_WAIT_TIME_; // range in seconds to wait between generation attempts
     std::unordered_map<int, std::shared_ptr<Passenger>> new_passengers_;
     std::unordered_map<int, std::shared_ptr<Passenger>> walking_passengers_;
-    std::shared_ptr<RideMatcher> ride_matcher_;
+    std::shared_ptr<MessageHandler> ride_matcher_;
+    std::shared_ptr<Market> market_;
+    int patience_ms_ = 0;
+    std::string patience_distribution_;
+    int priority_percent_ = 0;
 };
 
 }  // namespace rideshare
@@ -8,29 +8,66 @@
 
 #include "ride_matcher.h"
 
+#include <algorithm>
+#include <chrono>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <cmath>
+#include <variant>
+#include <vector>
 
 #include "passenger_queue.h"
 #include "simple_message.h"
 #include "vehicle_manager.h"
+#include "dispatch/assignment.h"
 #include "map_object/passenger.h"
+#include "map_object/vehicle.h"
+#include "routing/distance_cache.h"
 
 namespace rideshare {
 
-void RideMatcher::PassengerRequestsRide(int p_id) {
-    passenger_ids_.emplace(p_id);
+void RideMatcher::PassengerRequestsRide(int p_id, const RideRequest &request) {
+    ride_requests_[p_id] = request;
+    // Serve in order of the first request, moved up for priority riders; a re-request keeps any failure penalty
+    if (!request_queue_.Contains(p_id)) {
+        request_queue_.Push(p_id, request.request_time - std::chrono::milliseconds(request.priority ? PRIORITY_HEAD_START_MS_ : 0));
+    }
+    auto now = std::chrono::steady_clock::now();
+    MarketEvent(Market::request_opened, p_id, request.position);
+    // Time out with whatever patience is left, even if waited out elsewhere first
+    if (request.abandon_time != std::chrono::steady_clock::time_point::max()) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(request.abandon_time - now).count();
+        abandon_timers_.Arm(p_id, std::max((int)left, 0));
+    }
 }
 
-void RideMatcher::VehicleRequestsPassenger(int v_id) {
+void RideMatcher::VehicleRequestsPassenger(int v_id, const VehicleOffer &offer) {
     vehicle_ids_.emplace(v_id);
+    vehicle_offers_[v_id] = offer;
+    // Count where the vehicle will be free, if still on the way to a drop off
+    MarketEvent(Market::vehicle_opened, v_id, FreePosition(v_id));
+}
+
+void RideMatcher::VehicleMoved(int v_id, const VehicleOffer &offer) {
+    // Only while still open here; a match or another zone may have taken it since the move was sent
+    if (vehicle_ids_.count(v_id) == 1) {
+        vehicle_offers_[v_id] = offer;
+    }
 }
 
-void RideMatcher::VehicleCannotReachPassenger(int v_id) {
-    // Remove the match
-    int p_id = vehicle_to_passenger_match_.at(v_id);
-    vehicle_to_passenger_match_.erase(v_id);
+void RideMatcher::VehicleCannotReachPassenger(int p_id) {
+    if (passenger_to_vehicle_match_.count(p_id) == 0) {
+        // Already un-matched
+        return;
+    }
+    // Remove the match, and the passenger's stops from any pooled plan
+    int v_id = passenger_to_vehicle_match_.at(p_id);
     passenger_to_vehicle_match_.erase(p_id);
+    RemovePlannedStop(v_id, p_id, true);
+    RemovePlannedStop(v_id, p_id, false);
+    detour_budgets_.erase(p_id);
     // Track to make sure don't re-assign this pair
     invalid_matches_.emplace(std::pair{p_id, v_id});
     // Output the un-match to console
@@ -41,56 +78,90 @@ void RideMatcher::VehicleCannotReachPassenger(int v_id) {
     passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::passenger_failure, .id = p_id });
 }
 
-void RideMatcher::VehicleHasArrived(int v_id) {
+void RideMatcher::VehicleHasArrived(int p_id) {
     // Tell PassengerQueue to send passenger to vehicle
-    int p_id = vehicle_to_passenger_match_.at(v_id);
     passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::ride_arrived, .id = p_id });
 }
 
-void RideMatcher::PassengerToVehicle(int p_id) {
-    auto passenger = passenger_queue_->WalkingPassengers().at(p_id);
+void RideMatcher::PassengerToVehicle(int p_id, const std::shared_ptr<Passenger> &passenger) {
     // Add passenger to related vehicle
     int v_id = passenger_to_vehicle_match_.at(p_id);
     vehicle_manager_->PassengerIntoVehicle(v_id, passenger);
-    // Remove both from match maps
+    // Move from matched to riding
     passenger_to_vehicle_match_.erase(p_id);
-    vehicle_to_passenger_match_.erase(v_id);
+    riding_passengers_.emplace(p_id, v_id);
+    RemovePlannedStop(v_id, p_id, true);
     // Clear out any invalid matches from before
     ClearInvalids(p_id);
     // Let passenger queue know passenger was picked up
     passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::passenger_picked_up, .id = p_id });
 }
 
+void RideMatcher::VehicleDroppedOff(int p_id) {
+    if (riding_passengers_.count(p_id) == 1) {
+        RemovePlannedStop(riding_passengers_.at(p_id), p_id, false);
+        riding_passengers_.erase(p_id);
+    }
+    detour_budgets_.erase(p_id);
+}
+
 void RideMatcher::PassengerIsIneligible(int p_id) {
     // Remove passenger
-    passenger_ids_.erase(p_id);
+    request_queue_.Erase(p_id);
+    ride_requests_.erase(p_id);
+    abandon_timers_.Cancel(p_id);
+    MarketEvent(Market::request_closed, p_id);
     // Check for any associated match
     if (passenger_to_vehicle_match_.count(p_id) == 1) {
-        // Found a match, remove both sides
+        // Found a match, remove it and any planned stops
         int v_id = passenger_to_vehicle_match_.at(p_id);
-        vehicle_to_passenger_match_.erase(v_id);
         passenger_to_vehicle_match_.erase(p_id);
+        RemovePlannedStop(v_id, p_id, true);
+        RemovePlannedStop(v_id, p_id, false);
         // Note: Currently do not need to notify vehicle of failure,
         //  only way to get here is through vehicle issues first
     }
+    detour_budgets_.erase(p_id);
     // Clear out any invalid matches from before
     ClearInvalids(p_id);
 }
 
 void RideMatcher::VehicleIsIneligible(int v_id) {
-    // Remove vehicle
+    // Remove vehicle, along with any plan
     vehicle_ids_.erase(v_id);
-    // Check for any associated match
-    if (vehicle_to_passenger_match_.count(v_id) == 1) {
+    vehicle_offers_.erase(v_id);
+    MarketEvent(Market::vehicle_closed, v_id);
+    plans_.erase(v_id);
+    // Check for any associated matches
+    std::vector<int> matched;
+    for (const auto & [p_id, matched_v_id] : passenger_to_vehicle_match_) {
+        if (matched_v_id == v_id) {
+            matched.emplace_back(p_id);
+        }
+    }
+    for (int p_id : matched) {
         // Found a match, remove both sides
-        int p_id = vehicle_to_passenger_match_.at(v_id);
-        vehicle_to_passenger_match_.erase(v_id);
         passenger_to_vehicle_match_.erase(p_id);
+        detour_budgets_.erase(p_id);
         // Notify passenger of failure
         passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::passenger_failure, .id = p_id });
     }
 }
 
+void RideMatcher::VehicleLeavesZone(int v_id) {
+    vehicle_ids_.erase(v_id);
+    vehicle_offers_.erase(v_id);
+    // Note: counted again by the market as its new zone opens it
+}
+
+void RideMatcher::PassengerLeavesZone(int p_id) {
+    // Never matched here by now, so only need to drop from waiting
+    request_queue_.Erase(p_id);
+    ride_requests_.erase(p_id);
+    abandon_timers_.Cancel(p_id);
+    ClearInvalids(p_id);
+}
+
 void RideMatcher::Simulate() {
     // Launch MatchRides function in a thread
     threads.emplace_back(std::thread(&RideMatcher::MatchRides, this));
@@ -99,40 +170,58 @@ void RideMatcher::Simulate() {
 void RideMatcher::MatchRides() {
     while (true) {
         // Sleep at every iteration to reduce CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds(CYCLE_MS_));
 
-        // Read and act on any messages
-        ReadMessages();
+        MatchCycle();
+    }
+}
 
-        // Match rides if more than one in each related queue
-        if (passenger_ids_.size() > 0 && vehicle_ids_.size() > 0) {
-            if (MATCH_TYPE_ == "closest") {
-                ClosestMatch();
-            } else {
-                SimpleMatch();
+void RideMatcher::MatchCycle() {
+    // Read and act on any messages
+    ReadMessages();
+    open_vehicles_ = vehicle_ids_.size();
+
+    // Match rides if more than one in each related queue
+    if (!request_queue_.Empty() && vehicle_ids_.size() > 0) {
+        if (CAPACITY_ > 1) {
+            // Note: each request is inserted into the vehicle plans as it comes, regardless of any window
+            PooledMatch();
+        } else if (window_ms_ > 0) {
+            if (WindowClosed()) {
+                BatchMatch();
             }
+        } else if (MATCH_TYPE_ == "closest") {
+            ClosestMatch();
+        } else if (MATCH_TYPE_ == "knn") {
+            KnnMatch();
+        } else {
+            SimpleMatch();
         }
+    } else if (!request_queue_.Empty() && router_ != nullptr) {
+        // Nothing to match with in this zone
+        HandOffWaiting();
     }
+
+    // Let those whose patience ran out give up
+    AbandonWaiting();
 }
 
 void RideMatcher::ClosestMatch() {
     // Get first passenger and their location
-    int p_id = *passenger_ids_.begin();
-    Coordinate p_loc = passenger_queue_->NewPassengers().at(p_id)->GetPosition();
+    int p_id = request_queue_.Top();
+    Coordinate p_loc = ride_requests_.at(p_id).position;
     // Set up needed vehicle data + structures
     std::map<double, int> vehicle_distances; // ordered map of distance and v_id
-    Coordinate v_loc;
     auto vehicle_iterator = vehicle_ids_.begin();
 
     // Find a vehicle that is "close enough" or closest to first passenger
     while (true) {
         int v_id = *vehicle_iterator;
-        v_loc = vehicle_manager_->Vehicles().at(v_id)->GetPosition();
-        double distance = Distance(p_loc, v_loc);
+        double distance = ReachDistance(v_id, p_loc);
         bool valid = MatchIsValid(p_id, v_id);
         if ((distance <= CLOSE_ENOUGH_) && valid) {
             // Make the match
-            ProcessSingleMatch(p_id, v_id);
+            ProcessSingleMatch(p_id, v_id, NextInsertion(p_id, v_id));
             break; // end the loop
         } else {
             // Add to vehicle_distances if valid
@@ -147,7 +236,7 @@ void RideMatcher::ClosestMatch() {
                 // Try to use the closest (valid) vehicle
                 if (!vehicle_distances.empty()) {
                     // Make the match
-                    ProcessSingleMatch(p_id, (*vehicle_distances.begin()).second);
+                    ProcessSingleMatch(p_id, (*vehicle_distances.begin()).second, NextInsertion(p_id, (*vehicle_distances.begin()).second));
                 } else {
                     // No currently possible matches
                     NoPossibleMatch(p_id);
@@ -160,15 +249,14 @@ void RideMatcher::ClosestMatch() {
 
 void RideMatcher::SimpleMatch() {
     // Match rides using just first of each passenger / vehicle
-    auto passenger_iterator = passenger_ids_.begin();
+    int p_id = request_queue_.Top();
     auto vehicle_iterator = vehicle_ids_.begin();
     // Try to get a single match for a passenger
     while (true) {
-        int p_id = *passenger_iterator;
         int v_id = *vehicle_iterator;
         if (MatchIsValid(p_id, v_id)) {
             // Make the match
-            ProcessSingleMatch(p_id, v_id);
+            ProcessSingleMatch(p_id, v_id, NextInsertion(p_id, v_id));
             break; // end the loop
         } else { // invalid match
             // Try to check any other vehicles
@@ -184,19 +272,444 @@ void RideMatcher::SimpleMatch() {
     }
 }
 
-void RideMatcher::ProcessSingleMatch(int p_id, int v_id) {
+void RideMatcher::KnnMatch() {
+    // Index vehicles by where they will be free, rebuilt every cycle as they keep moving
+    std::vector<std::pair<int, Coordinate>> open_vehicles;
+    for (int v_id : vehicle_ids_) {
+        open_vehicles.emplace_back(v_id, FreePosition(v_id));
+    }
+    vehicle_grid_.Build(open_vehicles);
+
+    // Rebuilding takes a pass over every vehicle, so make several matches from each build
+    for (int match = 0; match < KNN_MATCHES_PER_CYCLE_ && !request_queue_.Empty() && !vehicle_ids_.empty(); ++match) {
+        // Get first passenger and their location
+        int p_id = request_queue_.Top();
+        Coordinate p_loc = ride_requests_.at(p_id).position;
+        // Leave out any previously unable to reach this passenger, looking further out in their place
+        std::vector<int> candidates = vehicle_grid_.Nearest(p_loc, KNN_CANDIDATES_,
+                                                            [&](int v_id) { return MatchIsValid(p_id, v_id); });
+        std::vector<int> candidate_nodes;
+        for (int v_id : candidates) {
+            candidate_nodes.emplace_back(road_graph_.NearestNode(FreePosition(v_id)));
+        }
+
+        // A single search out from the passenger reaches each candidate, as roads are two-way
+        std::vector<float> road_distances = distance_cache_.ToMany(road_graph_.NearestNode(p_loc), candidate_nodes);
+        int best = -1;
+        double best_distance = DistanceCache::UNREACHABLE;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            double remaining = vehicle_offers_.at(candidates[i]).remaining;
+            if (road_distances[i] + remaining < best_distance) {
+                best = candidates[i];
+                best_distance = road_distances[i] + remaining;
+            }
+        }
+
+        if (best != -1) {
+            vehicle_grid_.Remove(best, FreePosition(best));
+            ProcessSingleMatch(p_id, best, NextInsertion(p_id, best));
+        } else {
+            // No currently possible matches, e.g. none of the nearest can reach the passenger by road. Deferred,
+            //  they may still be first in line, so stop until next cycle rather than failing them again
+            NoPossibleMatch(p_id);
+            break;
+        }
+    }
+}
+
+void RideMatcher::PooledMatch() {
+    // Get first passenger
+    int p_id = request_queue_.Top();
+    // Get the nodes of their pick up and drop off
+    StopInsertion insertion = FrontInsertion(p_id);
+    int pickup_node = road_graph_.NearestNode(insertion.pickup.location);
+    int dropoff_node = road_graph_.NearestNode(insertion.dropoff.location);
+    // Every distance below involves one of these two, so search from each once up front
+    distance_cache_.Warm(pickup_node);
+    distance_cache_.Warm(dropoff_node);
+    float direct = distance_cache_.Distance(pickup_node, dropoff_node);
+    if (direct == DistanceCache::UNREACHABLE) {
+        NoPossibleMatch(p_id);
+        return;
+    }
+    float max_ride = direct * (1.0f + MAX_DETOUR_);
+
+    // Cheapest insertion found so far: pick up before stop i, drop off before stop j (right after pick up if i == j)
+    float best_cost = DistanceCache::UNREACHABLE;
+    int best_v_id = -1, best_i = 0, best_j = 0;
+    bool any_in_reach = false; // any vehicle able to get to the pick up within MAX_PICKUP_
+    std::vector<float> to_pickup, to_dropoff, arrival;
+    std::vector<int> load, pickup_index;
+
+    for (int v_id : vehicle_ids_) {
+        if (!MatchIsValid(p_id, v_id)) {
+            continue;
+        }
+        auto plan = plans_.find(v_id);
+        if (plan == plans_.end()) {
+            // No stops yet, so drive from where the vehicle is now, if not too far out
+            int v_node = road_graph_.NearestNode(vehicle_offers_.at(v_id).position);
+            float pickup = distance_cache_.Distance(pickup_node, v_node);
+            if (!(pickup <= MAX_PICKUP_)) {
+                continue;
+            }
+            any_in_reach = true;
+            float cost = pickup + direct;
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_v_id = v_id;
+                best_i = best_j = 0;
+            }
+            continue;
+        }
+
+        // Distances to each planned stop, arrival along the plan, where each drop off's passenger
+        //  is picked up (-1 if already riding), and passengers riding after each stop
+        const std::vector<PlannedStop> &stops = plan->second;
+        const int n = stops.size();
+        to_pickup.resize(n);
+        to_dropoff.resize(n);
+        arrival.resize(n);
+        load.resize(n);
+        pickup_index.assign(n, -1);
+        int riding = 0;
+        for (int k = 0; k < n; ++k) {
+            to_pickup[k] = distance_cache_.Distance(pickup_node, stops[k].node);
+            to_dropoff[k] = distance_cache_.Distance(dropoff_node, stops[k].node);
+            arrival[k] = (k == 0) ? 0.0f : arrival[k - 1] + stops[k].leg;
+            load[k] = ((k == 0) ? 0 : load[k - 1]) + (stops[k].stop.pickup ? 1 : -1);
+            if (!stops[k].stop.pickup) {
+                for (int m = 0; m < k; ++m) {
+                    if (stops[m].stop.passenger_id == stops[k].stop.passenger_id) {
+                        pickup_index[k] = m;
+                    }
+                }
+                riding += (pickup_index[k] == -1) ? 1 : 0;
+            }
+        }
+        for (int k = 0; k < n; ++k) {
+            load[k] += riding;
+        }
+
+        // The next stop is already being driven to, so only insert after it
+        for (int i = 1; i <= n; ++i) {
+            // Extra distance to go through the pick up before stop i. Going through the drop off too
+            //  can only add more, so skip if this alone can't beat the best
+            if (!(arrival[i - 1] + to_pickup[i - 1] <= MAX_PICKUP_)) {
+                continue;
+            }
+            any_in_reach = true;
+            float pickup_detour = to_pickup[i - 1] + ((i < n) ? to_pickup[i] - stops[i].leg : 0.0f);
+            if (!(pickup_detour < best_cost)) {
+                continue;
+            }
+            for (int j = i; j <= n; ++j) {
+                // The new passenger takes up a seat after every stop between their pick up and drop off
+                if (load[j - 1] + 1 > CAPACITY_) {
+                    break;
+                }
+                float cost, ride;
+                if (j == i) {
+                    cost = to_pickup[i - 1] + direct + ((i < n) ? to_dropoff[i] - stops[i].leg : 0.0f);
+                    ride = direct;
+                } else {
+                    cost = pickup_detour + to_dropoff[j - 1] + ((j < n) ? to_dropoff[j] - stops[j].leg : 0.0f);
+                    ride = to_pickup[i] + (arrival[j - 1] - arrival[i]) + to_dropoff[j - 1];
+                }
+                // Written to also skip costs through unreachable stops (infinite, or not a number)
+                if (!(cost < best_cost) || ride > max_ride) {
+                    continue;
+                }
+                // Stops from i on are reached later; each planned passenger's ride can only grow within their
+                //  budget, and those still waiting can't be left too far out
+                auto delay = [&](int k) { return (k < i) ? 0.0f : (k < j) ? pickup_detour : cost; };
+                bool within_detours = true;
+                for (int k = i; k < n && within_detours; ++k) {
+                    if (stops[k].stop.pickup) {
+                        within_detours = arrival[k] + delay(k) <= MAX_PICKUP_;
+                    } else {
+                        float added_ride = delay(k) - ((pickup_index[k] == -1) ? 0.0f : delay(pickup_index[k]));
+                        within_detours = added_ride <= detour_budgets_[stops[k].stop.passenger_id];
+                    }
+                }
+                if (within_detours) {
+                    best_cost = cost;
+                    best_v_id = v_id;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+    }
+
+    if (!any_in_reach) {
+        // No currently possible matches, as no vehicle (not already failed) can reach the passenger in time
+        NoPossibleMatch(p_id);
+        return;
+    } else if (best_v_id == -1) {
+        // Some can reach them, but have no room or would detour others too far for now; let others be tried
+        //  first, and try again once vehicles have made some stops
+        DeferRequest(p_id);
+        return;
+    }
+
+    // Mirror the new stops into the vehicle's plan, with legs to and from their neighbors
+    std::vector<PlannedStop> &stops = plans_[best_v_id];
+    std::unordered_map<int, float> rides_before = PlannedRides(stops);
+    const int n = stops.size();
+    float leg_to_pickup = (best_i > 0) ? distance_cache_.Distance(pickup_node, stops[best_i - 1].node) : 0.0f;
+    if (best_i == best_j) {
+        if (best_i < n) {
+            stops[best_i].leg = distance_cache_.Distance(dropoff_node, stops[best_i].node);
+        }
+        stops.insert(stops.begin() + best_i, { insertion.dropoff, dropoff_node, direct });
+    } else {
+        float leg_to_dropoff = distance_cache_.Distance(dropoff_node, stops[best_j - 1].node);
+        if (best_j < n) {
+            stops[best_j].leg = distance_cache_.Distance(dropoff_node, stops[best_j].node);
+        }
+        stops.insert(stops.begin() + best_j, { insertion.dropoff, dropoff_node, leg_to_dropoff });
+        stops[best_i].leg = distance_cache_.Distance(pickup_node, stops[best_i].node);
+    }
+    stops.insert(stops.begin() + best_i, { insertion.pickup, pickup_node, leg_to_pickup });
+    // Tell the vehicle where its new stops go, relative to stops it already has
+    if (best_i > 0) {
+        insertion.pickup_after = stops[best_i - 1].stop;
+    }
+    insertion.dropoff_after = stops[best_j].stop; // just before the drop off, now shifted by the pick up
+
+    // Others' rides grew by the detour, and the new passenger has whatever extra allowance remains
+    for (const auto & [rider, ride] : PlannedRides(stops)) {
+        if (rider == p_id) {
+            detour_budgets_[p_id] = max_ride - ride;
+        } else {
+            detour_budgets_[rider] -= ride - rides_before[rider];
+        }
+    }
+    ProcessSingleMatch(p_id, best_v_id, insertion);
+}
+
+void RideMatcher::HandOffWaiting() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_hand_off_ < std::chrono::milliseconds(HAND_OFF_WAIT_MS_)) {
+        return;
+    }
+    last_hand_off_ = now;
+    // Copy the ids, as handing off removes them from the queue
+    std::vector<int> waiting;
+    for (int p_id : request_queue_.Ids()) {
+        if (now - ride_requests_.at(p_id).request_time >= std::chrono::milliseconds(HAND_OFF_WAIT_MS_)) {
+            waiting.emplace_back(p_id);
+        }
+    }
+    // Re-request through the router, which hands them to the nearest zone with open vehicles (or back here if none)
+    for (int p_id : waiting) {
+        request_queue_.Erase(p_id);
+        router_->Message({ .message_code = MsgCodes::passenger_handed_off, .id = p_id, .payload = ride_requests_.at(p_id) });
+    }
+}
+
+void RideMatcher::AbandonWaiting() {
+    // Timers are cancelled on matches, but a passenger just handed off may still expire before this zone hears of it
+    for (int p_id : abandon_timers_.Advance(std::chrono::steady_clock::now())) {
+        if (!request_queue_.Contains(p_id)) {
+            continue;
+        }
+        // Never matched, so only this side needs clearing out before the passenger queue removes them
+        request_queue_.Erase(p_id);
+        ride_requests_.erase(p_id);
+        ClearInvalids(p_id);
+        MarketEvent(Market::request_closed, p_id);
+        if (metrics_ != nullptr) {
+            metrics_->Increment("abandoned_passengers");
+        }
+        passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::passenger_abandoned, .id = p_id });
+    }
+}
+
+void RideMatcher::MarketEvent(Market::EventKind kind, int id, Coordinate position) {
+    if (market_ != nullptr) {
+        market_->Record({ .kind = kind, .id = id, .position = position });
+    }
+}
+
+bool RideMatcher::WindowClosed() {
+    if (window_requests_ > 0 && (int)request_queue_.Size() >= window_requests_) {
+        return true;
+    }
+    // Otherwise, wait until the oldest request has used up the window
+    auto oldest = std::chrono::steady_clock::time_point::max();
+    for (int p_id : request_queue_.Ids()) {
+        oldest = std::min(oldest, ride_requests_.at(p_id).request_time);
+    }
+    return std::chrono::steady_clock::now() - oldest >= std::chrono::milliseconds(window_ms_);
+}
+
+void RideMatcher::BatchMatch() {
+    // Copy the ids, as matching removes them from the sets. With more passengers than vehicles, only those
+    //  to be served first are matched, so the least total distance never comes at the cost of the longest waits
+    size_t batch_size = vehicle_ids_.size();
+    if (batch_limit_ > 0) {
+        batch_size = std::min(batch_size, (size_t)batch_limit_);
+    }
+    std::vector<int> p_ids = request_queue_.First(batch_size);
+    std::vector<int> v_ids;
+    if (batch_limit_ > 0 && vehicle_ids_.size() > p_ids.size() * KNN_CANDIDATES_) {
+        // Solving takes time with each vehicle too, so only offer those nearest to someone in the batch
+        std::vector<std::pair<int, Coordinate>> open_vehicles;
+        for (int v_id : vehicle_ids_) {
+            open_vehicles.emplace_back(v_id, FreePosition(v_id));
+        }
+        vehicle_grid_.Build(open_vehicles);
+        std::unordered_set<int> candidates;
+        for (int p_id : p_ids) {
+            for (int v_id : vehicle_grid_.Nearest(ride_requests_.at(p_id).position, KNN_CANDIDATES_)) {
+                if (candidates.insert(v_id).second) {
+                    v_ids.emplace_back(v_id);
+                }
+            }
+        }
+    } else {
+        v_ids.assign(vehicle_ids_.begin(), vehicle_ids_.end());
+    }
+    const int rows = p_ids.size(), columns = v_ids.size();
+    // Distance between every passenger and vehicle, far too costly to ever pick if the pair was unreachable
+    std::vector<double> costs(rows * columns);
+    std::vector<bool> any_valid(rows, false);
+    for (int c = 0; c < columns; ++c) {
+        for (int r = 0; r < rows; ++r) {
+            if (MatchIsValid(p_ids[r], v_ids[c])) {
+                costs[(r * columns) + c] = ReachDistance(v_ids[c], ride_requests_.at(p_ids[r]).position);
+                any_valid[r] = true;
+            } else {
+                costs[(r * columns) + c] = INVALID_COST_;
+            }
+        }
+    }
+
+    std::vector<int> assigned = MinCostAssignment(costs, rows, columns);
+    int matched = 0;
+    for (int r = 0; r < rows; ++r) {
+        int c = assigned[r];
+        if (c != -1 && costs[(r * columns) + c] < INVALID_COST_) {
+            ProcessSingleMatch(p_ids[r], v_ids[c], NextInsertion(p_ids[r], v_ids[c]));
+            ++matched;
+        } else if (!any_valid[r]) {
+            // No currently possible matches
+            NoPossibleMatch(p_ids[r]);
+        }
+        // Otherwise, more passengers than vehicles for now, so wait for the next window
+    }
+    if (metrics_ != nullptr) {
+        metrics_->Record("match_batch_size", matched);
+    }
+}
+
+std::unordered_map<int, float> RideMatcher::PlannedRides(const std::vector<PlannedStop> &stops) {
+    std::unordered_map<int, float> rides;
+    float arrival = 0.0f;
+    for (size_t k = 0; k < stops.size(); ++k) {
+        if (k > 0) {
+            arrival += stops[k].leg;
+        }
+        // Rides are measured from the pick up, or from now if already riding
+        const Stop &stop = stops[k].stop;
+        if (stop.pickup) {
+            rides[stop.passenger_id] = -arrival;
+        } else {
+            rides[stop.passenger_id] += arrival;
+        }
+    }
+    return rides;
+}
+
+StopInsertion RideMatcher::FrontInsertion(int p_id) {
+    const RideRequest &request = ride_requests_.at(p_id);
+    StopInsertion insertion;
+    insertion.pickup = { .passenger_id = p_id, .pickup = true, .location = request.position };
+    insertion.dropoff = { .passenger_id = p_id, .pickup = false, .location = request.destination };
+    insertion.dropoff_after = insertion.pickup;
+    return insertion;
+}
+
+double RideMatcher::ReachDistance(int v_id, const Coordinate &position) {
+    const VehicleOffer &offer = vehicle_offers_.at(v_id);
+    if (offer.chained_passenger_id != -1) {
+        return offer.remaining + Distance(position, offer.dropoff);
+    }
+    return Distance(position, offer.position);
+}
+
+Coordinate RideMatcher::FreePosition(int v_id) {
+    const VehicleOffer &offer = vehicle_offers_.at(v_id);
+    return (offer.chained_passenger_id != -1) ? offer.dropoff : offer.position;
+}
+
+StopInsertion RideMatcher::NextInsertion(int p_id, int v_id) {
+    StopInsertion insertion = FrontInsertion(p_id);
+    const VehicleOffer &offer = vehicle_offers_.at(v_id);
+    if (offer.chained_passenger_id != -1) {
+        // Chained onto the current ride; if already dropped off by the time it's added, goes at the front
+        insertion.pickup_after = { .passenger_id = offer.chained_passenger_id, .pickup = false, .location = offer.dropoff };
+        if (metrics_ != nullptr) {
+            metrics_->Increment("chained_matches");
+        }
+    }
+    return insertion;
+}
+
+void RideMatcher::RemovePlannedStop(int v_id, int p_id, bool pickup) {
+    auto plan = plans_.find(v_id);
+    if (plan == plans_.end()) {
+        return;
+    }
+    std::vector<PlannedStop> &stops = plan->second;
+    for (size_t k = 0; k < stops.size(); ++k) {
+        if (stops[k].stop.passenger_id != p_id || stops[k].stop.pickup != pickup) {
+            continue;
+        }
+        // Stops are usually made in order, from the front; otherwise re-link the neighbors
+        if (k > 0 && k + 1 < stops.size()) {
+            stops[k + 1].leg = distance_cache_.Distance(stops[k - 1].node, stops[k + 1].node);
+        }
+        stops.erase(stops.begin() + k);
+        break;
+    }
+    if (stops.empty()) {
+        plans_.erase(plan);
+    }
+}
+
+void RideMatcher::ProcessSingleMatch(int p_id, int v_id, const StopInsertion &insertion) {
+    // Record how long the passenger waited to be matched, and how far away (approx. meters) their vehicle is
+    if (metrics_ != nullptr) {
+        auto now = std::chrono::steady_clock::now();
+        const RideRequest &request = ride_requests_.at(p_id);
+        double wait = std::chrono::duration<double, std::milli>(now - request.request_time).count();
+        metrics_->Record(request.priority ? "priority_match_wait_ms" : "match_wait_ms", wait);
+        Coordinate p_loc = request.position;
+        Coordinate v_loc = vehicle_offers_.at(v_id).position;
+        double dx = (p_loc.x - v_loc.x) * cos(p_loc.y * M_PI / 180.0);
+        metrics_->Record("match_distance_m", METERS_PER_DEGREE_ * sqrt((dx * dx) + pow(p_loc.y - v_loc.y, 2.0)));
+    }
+    abandon_timers_.Cancel(p_id);
     // Make the match
-    vehicle_to_passenger_match_.insert({v_id, p_id});
     passenger_to_vehicle_match_.insert({p_id, v_id});
-    // Remove the ids from the sets
-    passenger_ids_.erase(p_id);
-    vehicle_ids_.erase(v_id);
+    // Remove the ids from the sets, though a pooled vehicle can keep taking passengers
+    request_queue_.Erase(p_id);
+    ride_requests_.erase(p_id);
+    MarketEvent(Market::request_closed, p_id);
+    if (CAPACITY_ == 1) {
+        vehicle_ids_.erase(v_id);
+        vehicle_offers_.erase(v_id);
+        MarketEvent(Market::vehicle_closed, v_id);
+    }
     // Output the match to console
     std::unique_lock<std::mutex> lck(mtx_);
     std::cout << "Vehicle #" << v_id << " matched to Passenger #" << p_id << "." << std::endl;
     lck.unlock();
     // Notify PassengerQueue and VehicleManager
-    vehicle_manager_->AssignPassenger(v_id, passenger_queue_->NewPassengers().at(p_id)->GetPosition());
+    vehicle_manager_->AssignPassenger(v_id, insertion);
     passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::ride_on_way, .id = p_id });
 }
 
@@ -205,6 +718,14 @@ void RideMatcher::NoPossibleMatch(int p_id) {
     // Notify passenger of failure (sort of double counts, but avoids keeping them if fewer vehicles than needed failures)
     passenger_queue_->Message({ .message_code = PassengerQueue::MsgCodes::passenger_failure, .id = p_id });
     // Note that vehicle notification is unnecessary, as a stuck vehicle will eventually fail on its own at finding viable paths
+    // Let others be tried first, rather than retrying the same failing passenger every cycle
+    DeferRequest(p_id);
+}
+
+void RideMatcher::DeferRequest(int p_id) {
+    if (request_queue_.Contains(p_id)) {
+        request_queue_.Push(p_id, request_queue_.Key(p_id) + std::chrono::milliseconds(DEFER_MS_));
+    }
 }
 
 bool RideMatcher::MatchIsValid(int p_id, int v_id) {
@@ -238,21 +759,29 @@ void RideMatcher::Message(SimpleMessage simple_message) {
 }
 
 void RideMatcher::ReadMessages() {
-    // Lock and copy over the messages so can release the mutex faster
+    // Lock and move out the messages so can release the mutex faster, as payloads make them larger to copy
     std::unique_lock<std::mutex> lck(messages_mutex_);
-    std::vector<SimpleMessage> copied_messages(messages_);
-    // Clear out the original messages and unlock
-    messages_.clear();
+    std::vector<SimpleMessage> copied_messages;
+    copied_messages.swap(messages_);
     lck.unlock();
 
-    // Take action based on each message code
-    for (auto message : copied_messages) {
+    // Take action based on each message code, ignoring any missing the payload it calls for
+    for (const auto &message : copied_messages) {
         switch (message.message_code) {
             case MsgCodes::passenger_requests_ride:
-                PassengerRequestsRide(message.id);
+                if (auto request = std::get_if<RideRequest>(&message.payload)) {
+                    PassengerRequestsRide(message.id, *request);
+                }
                 break;
             case MsgCodes::vehicle_requests_passenger:
-                VehicleRequestsPassenger(message.id);
+                if (auto offer = std::get_if<VehicleOffer>(&message.payload)) {
+                    VehicleRequestsPassenger(message.id, *offer);
+                }
+                break;
+            case MsgCodes::vehicle_moved:
+                if (auto offer = std::get_if<VehicleOffer>(&message.payload)) {
+                    VehicleMoved(message.id, *offer);
+                }
                 break;
             case MsgCodes::vehicle_cannot_reach_passenger:
                 VehicleCannotReachPassenger(message.id);
@@ -261,7 +790,12 @@ void RideMatcher::ReadMessages() {
                 VehicleHasArrived(message.id);
                 break;
             case MsgCodes::passenger_to_vehicle:
-                PassengerToVehicle(message.id);
+                if (auto handoff = std::get_if<PassengerHandoff>(&message.payload)) {
+                    PassengerToVehicle(message.id, handoff->passenger);
+                }
+                break;
+            case MsgCodes::vehicle_dropped_off:
+                VehicleDroppedOff(message.id);
                 break;
             case MsgCodes::passenger_is_ineligible:
                 PassengerIsIneligible(message.id);
@@ -269,6 +803,12 @@ void RideMatcher::ReadMessages() {
             case MsgCodes::vehicle_is_ineligible:
                 VehicleIsIneligible(message.id);
                 break;
+            case MsgCodes::vehicle_leaves_zone:
+                VehicleLeavesZone(message.id);
+                break;
+            case MsgCodes::passenger_leaves_zone:
+                PassengerLeavesZone(message.id);
+                break;
             default:
                 // Invalid message, ignore
                 continue;
@@ -9,43 +9,83 @@
 #ifndef RIDE_MATCHER_H_
 #define RIDE_MATCHER_H_
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 #include <set>
 #include <thread>
 #include <utility>
+#include <vector>
 
 #include "concurrent_object.h"
 #include "message_handler.h"
 #include "passenger_queue.h"
 #include "simple_message.h"
+#include "timing_wheel.h"
 #include "vehicle_manager.h"
+#include "dispatch/market.h"
+#include "dispatch/request_queue.h"
+#include "mapping/point_grid.h"
 #include "map_object/passenger.h"
+#include "map_object/vehicle.h"
+#include "metrics/metrics.h"
+#include "routing/distance_cache.h"
+#include "routing/road_graph.h"
 
 namespace rideshare {
 
 class RideMatcher : public ConcurrentObject, public MessageHandler {
   public:
-    // Messages are received with below enum code and either vehicle or passenger id
+    // Messages are received with below enum code and either vehicle or passenger id, plus any payload noted
     enum MsgCodes {
-        passenger_requests_ride,
-        vehicle_requests_passenger,
-        vehicle_cannot_reach_passenger,
-        vehicle_has_arrived,
-        passenger_to_vehicle,
-        passenger_is_ineligible,
-        vehicle_is_ineligible,
+        passenger_requests_ride,        // passenger id, RideRequest
+        vehicle_requests_passenger,     // vehicle id, VehicleOffer
+        vehicle_cannot_reach_passenger, // passenger id
+        vehicle_has_arrived,            // passenger id
+        passenger_to_vehicle,           // passenger id, PassengerHandoff
+        vehicle_dropped_off,            // passenger id
+        passenger_is_ineligible,        // passenger id
+        vehicle_is_ineligible,          // vehicle id
+        vehicle_leaves_zone,            // vehicle id, from a zone router when it requests in another zone
+        passenger_leaves_zone,          // passenger id, from a zone router when handed to another zone
+        vehicle_moved,                  // vehicle id, VehicleOffer, as an open vehicle drives around or nears its drop off
+        passenger_handed_off,           // passenger id, RideRequest, from a zone to the router to try other zones
     };
 
     // Constructor / Destructor
     RideMatcher(std::shared_ptr<PassengerQueue> passenger_queue,
                 std::shared_ptr<VehicleManager> vehicle_manager_,
-                double map_dim, std::string match_type) :
+                double map_dim, std::string match_type,
+                const RoadGraph &road_graph, int capacity) :
       passenger_queue_(passenger_queue), vehicle_manager_(vehicle_manager_),
-      CLOSE_ENOUGH_(map_dim * MAP_FRACTION_), MATCH_TYPE_(match_type) {};
+      CLOSE_ENOUGH_(map_dim * MAP_FRACTION_), MATCH_TYPE_(match_type),
+      MAX_PICKUP_(map_dim * PICKUP_MAP_FRACTION_), road_graph_(road_graph), distance_cache_(road_graph, MAX_CACHED_ROWS_), CAPACITY_(capacity),
+      vehicle_grid_(road_graph.GetModel().MinLon(), road_graph.GetModel().MinLat(), road_graph.GetModel().MaxLon(),
+                    road_graph.GetModel().MaxLat(), VEHICLE_GRID_CELLS_) {};
+
+    // Setters
+    // Hold whole-vehicle matching until the oldest request has waited `window_ms`, or `window_requests` are waiting,
+    //  then match them all at once for the least total pickup distance. A window of 0 matches right away
+    void SetMatchWindow(int window_ms, int window_requests) { window_ms_ = window_ms; window_requests_ = window_requests; }
+    // Most requests in each batch solve, the first in line, against only their nearest open vehicles if there are
+    //  many more than that (0 solves every waiting request against every open vehicle)
+    void SetBatchLimit(int batch_limit) { batch_limit_ = batch_limit; }
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+    // Matching only one zone, so hand passengers left without any vehicle back to the router to try other zones
+    void SetZoneRouter(MessageHandler *router) { router_ = router; }
+    // Report changes to the pools of waiting passengers and open vehicles, for supply and demand per zone
+    void SetMarket(const std::shared_ptr<Market> &market) { market_ = market; }
+
+    // Getters
+    // Open vehicles as of the last matching cycle, for the router to compare zones' supply
+    int OpenVehicles() const { return open_vehicles_; }
 
     // Concurrent simulation
     void Simulate();
+    // A single cycle of reading messages and matching, as run by the matcher's thread. Can instead be called
+    //  directly, without Simulate, e.g. to benchmark matching
+    void MatchCycle();
 
     // Message receiving
     void Message(SimpleMessage simple_message);
@@ -53,37 +93,70 @@ class RideMatcher : public ConcurrentObject, public MessageHandler {
   private:
     // Pre-Matching
     // A given passenger requests to be matched with a ride
-    void PassengerRequestsRide(int p_id);
+    void PassengerRequestsRide(int p_id, const RideRequest &request);
     // A given vehicle requests to be matched to a rider
-    void VehicleRequestsPassenger(int v_id);
+    void VehicleRequestsPassenger(int v_id, const VehicleOffer &offer);
+    // An open vehicle has moved, so match from where it is (or will be free) now
+    void VehicleMoved(int v_id, const VehicleOffer &offer);
 
     // Matching
-    // Handles loop cycle of a single match at a time
+    // Handles loop cycle of a single match at a time, running MatchCycle
     void MatchRides();
-    // Matches earliest passenger ID (close to FIFO) to a close or closest vehicle
+    // Matches first passenger in the queue (longest waiting) to a close or closest vehicle
     void ClosestMatch();
-    // Matches earliest passenger ID to earliest available vehicle ID
+    // Matches first passenger in the queue to earliest available vehicle ID
     void SimpleMatch();
+    // Matches first passenger in the queue to whichever of the few straight-line closest vehicles is closest by road,
+    //  for up to KNN_MATCHES_PER_CYCLE_ passengers
+    void KnnMatch();
+    // Matches first passenger in the queue into the vehicle plan where its stops add the least driving, within
+    //  vehicle capacity, pick up distance and the detour allowed for each passenger (for capacity above 1)
+    void PooledMatch();
+    // Whether the matching window has closed for the passengers waiting to be matched
+    bool WindowClosed();
+    // Matches all waiting passengers to vehicles at once, for the least total distance between them
+    void BatchMatch();
+    // Hands passengers who have waited a while with no vehicles in the zone back to the router
+    void HandOffWaiting();
+    // Removes passengers whose patience ran out without a match, and has the passenger queue remove them too
+    void AbandonWaiting();
+    // Report a change to the pools to the market, if any (position only needed when opened)
+    void MarketEvent(Market::EventKind kind, int id, Coordinate position = Coordinate());
+    // Distance a single-passenger vehicle has to go to reach a position: from where it is now, or through
+    //  its drop off first if offered on the way there
+    double ReachDistance(int v_id, const Coordinate &position);
+    // Where a single-passenger vehicle will be free: its drop off if offered on the way there, or else where it is
+    Coordinate FreePosition(int v_id);
+    // Pick up and drop off of a passenger for a single-passenger vehicle, after any drop off still being driven to
+    StopInsertion NextInsertion(int p_id, int v_id);
     // Checks whether a given match was previously invalid due to being unreachable
     bool MatchIsValid(int p_id, int v_id);
-    // Once match is determined, removes both sides from queue and notifies the related parties
-    void ProcessSingleMatch(int p_id, int v_id);
+    // Once match is determined, removes both sides from queue (or keeps a pooled vehicle) and notifies the related parties
+    void ProcessSingleMatch(int p_id, int v_id, const StopInsertion &insertion);
     // No match is possible for the given passenger at this time, so notify them of a failure
     void NoPossibleMatch(int p_id);
+    // Move a passenger back in the queue by DEFER_MS_, so they still age but others are tried first
+    void DeferRequest(int p_id);
 
     // Post-Matching
-    // A given vehicle cannot reach their matched passenger, so needs to be unmatched
-    void VehicleCannotReachPassenger(int v_id);
-    // The matched vehicle has arrived at the closest rode node to the matched passenger position
-    void VehicleHasArrived(int v_id);
+    // A given passenger cannot be reached by their matched vehicle, so needs to be unmatched
+    void VehicleCannotReachPassenger(int p_id);
+    // The matched vehicle has arrived at the closest rode node to the given passenger's position
+    void VehicleHasArrived(int p_id);
     // Move the passenger into the arrived vehicle, and notify the passenger queue so it can remove
-    void PassengerToVehicle(int p_id);
+    void PassengerToVehicle(int p_id, const std::shared_ptr<Passenger> &passenger);
+    // A given passenger was dropped off, freeing up their seat
+    void VehicleDroppedOff(int p_id);
 
     // Removal
     // A given passenger is being deleted by the passenger queue, and should be un-matched or removed
     void PassengerIsIneligible(int p_id);
     // A given vehicle is being deleted by the vehicle manager, and should be un-matched or removed
     void VehicleIsIneligible(int v_id);
+    // A given vehicle is now offered in another zone, so stop matching it here, but keep any matches it already has
+    void VehicleLeavesZone(int v_id);
+    // A given passenger is now waiting in another zone, so forget them here
+    void PassengerLeavesZone(int p_id);
 
     // Message reading - take action based on given message
     void ReadMessages();
@@ -93,18 +166,66 @@ class RideMatcher : public ConcurrentObject, public MessageHandler {
     void ClearInvalids(int p_id);
     // Calculate Euclidean distance between two coordinates (passenger and vehicle)
     double Distance(Coordinate p_loc, Coordinate v_loc);
+    // Stops for a passenger's whole-vehicle ride: pick up first, with the drop off right after
+    StopInsertion FrontInsertion(int p_id);
+    // A stop in a pooled vehicle's plan, as mirrored here from what was sent to the vehicle manager.
+    //  Passengers with a drop off but no pick up in the plan are already riding
+    struct PlannedStop {
+        Stop stop;
+        int node;  // nearest road node
+        float leg; // road distance from the previous stop (unused for the first stop)
+    };
+    // Remove a passenger's stop from a pooled vehicle's plan, if it has one
+    void RemovePlannedStop(int v_id, int p_id, bool pickup);
+    // Distance each passenger in a plan will ride from their pick up (or from now, if riding) to drop off
+    std::unordered_map<int, float> PlannedRides(const std::vector<PlannedStop> &stops);
 
     // Member variables
     std::shared_ptr<PassengerQueue> passenger_queue_;
     std::shared_ptr<VehicleManager> vehicle_manager_;
-    std::set<int> passenger_ids_;
+    RequestQueue request_queue_; // waiting passengers, first to serve on top
+    std::unordered_map<int, RideRequest> ride_requests_; // p_id, as last requested, while waiting (ages from its first request_time)
     std::set<int> vehicle_ids_;
-    std::unordered_map<int, int> vehicle_to_passenger_match_;
-    std::unordered_map<int, int> passenger_to_vehicle_match_;
+    std::unordered_map<int, VehicleOffer> vehicle_offers_; // v_id, as last offered or moved, while open
+    std::unordered_map<int, int> passenger_to_vehicle_match_; // matched, not yet picked up
+    std::unordered_map<int, int> riding_passengers_; // p_id, v_id once picked up
     std::set<std::pair<int, int>> invalid_matches_; // p_id, v_id
+    const int PRIORITY_HEAD_START_MS_ = 30000; // Priority riders are served as if they had waited this much longer
+    const int DEFER_MS_ = 2000; // Penalty to a passenger's place in the queue each time they can't be matched
     const double MAP_FRACTION_ = 0.15; // Fraction of map to be "close enough"
     const double CLOSE_ENOUGH_; // Avg. map dimension * MAP_FRACTION_
-    const std::string MATCH_TYPE_; // "closest" or "simple" matching
+    const std::string MATCH_TYPE_; // "closest", "simple" or "knn" matching
+    // Batching
+    int window_ms_ = 0;
+    int window_requests_ = 0; // 0 for no limit
+    int batch_limit_ = 0; // 0 for no limit
+    std::shared_ptr<Metrics> metrics_;
+    const double METERS_PER_DEGREE_ = 111320.0; // Of latitude, for reporting match distances
+    const double INVALID_COST_ = 1e12; // Batch cost of an unreachable pair, far above any real distance
+    // Market
+    std::shared_ptr<Market> market_;
+    const int CYCLE_MS_ = 10; // Note: before abandon_timers_, which ticks once a cycle
+    TimingWheel abandon_timers_{CYCLE_MS_}; // p_id, armed to each waiting passenger's abandon time
+    // Zones
+    MessageHandler *router_ = nullptr; // only set when one of several zones
+    std::atomic<int> open_vehicles_ = 0;
+    std::chrono::steady_clock::time_point last_hand_off_;
+    const int HAND_OFF_WAIT_MS_ = 1000; // Wait, and time between hand offs, before passengers try other zones
+    // Pooling
+    const int MAX_CACHED_ROWS_ = 64; // Note: before distance_cache_, which is initialized with it
+    const double PICKUP_MAP_FRACTION_ = 0.5; // Fraction of map to be too far to add a pick up to a vehicle or its plan
+    const double MAX_PICKUP_; // Avg. map dimension * PICKUP_MAP_FRACTION_, as road distance from an idle vehicle or its next stop
+    const RoadGraph &road_graph_;
+    DistanceCache distance_cache_; // road distances from recent pick ups / drop offs
+    std::unordered_map<int, std::vector<PlannedStop>> plans_; // v_id, for pooled vehicles with planned stops
+    std::unordered_map<int, float> detour_budgets_; // p_id, extra ride distance each can still take on
+    const float MAX_DETOUR_ = 0.5f; // Max extra ride distance, as a fraction of the direct route
+    const int CAPACITY_; // Max passengers per vehicle; 1 matches whole vehicles as before
+    // K nearest matching
+    const int KNN_CANDIDATES_ = 8; // Straight-line nearest vehicles to compare by road distance
+    const int KNN_MATCHES_PER_CYCLE_ = 16; // Most matches from each rebuild of the index
+    const int VEHICLE_GRID_CELLS_ = 32; // Per side. Note: before vehicle_grid_, which is sized with it
+    PointGrid vehicle_grid_; // open vehicles, where each will be free
 };
 
 }  // namespace rideshare
@@ -1,6 +1,6 @@
 /**
  * @file simple_message.h
- * @brief Store two ints, one a message code, and the other an id (e.g. passenger id).
+ * @brief Store a message code and an id (e.g. passenger id), along with any payload the code calls for.
  *
  * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
  *
@@ -9,13 +9,43 @@
 #ifndef SIMPLE_MESSAGE_H_
 #define SIMPLE_MESSAGE_H_
 
+#include <chrono>
+#include <memory>
+#include <variant>
+
+#include "mapping/coordinate.h"
+
 namespace rideshare {
 
+class Passenger;
+
+// Payloads, copied as of sending, so the receiver never has to look into the sender's objects from its own thread
+// A passenger waiting for a ride, and what is needed to match and order them
+struct RideRequest {
+    Coordinate position;
+    Coordinate destination;
+    bool priority; // in the priority class
+    std::chrono::steady_clock::time_point request_time; // first request, kept through any failures or hand offs
+    std::chrono::steady_clock::time_point abandon_time; // time_point::max() if willing to wait forever
+};
+// Where an open vehicle is, and if offered while still on the way to a drop off, where and how soon it will be free
+struct VehicleOffer {
+    Coordinate position;
+    int chained_passenger_id = -1; // passenger still being driven to their drop off, or -1 if free now
+    Coordinate dropoff = {};
+    double remaining = 0.0; // distance left to drive to the drop off
+};
+// A passenger handed from one holder to another, e.g. from the passenger queue into their vehicle
+struct PassengerHandoff {
+    std::shared_ptr<Passenger> passenger;
+};
+
 struct SimpleMessage {
     int message_code; // should come from enum of class receiving message
     int id; // passenger or vehicle id
+    std::variant<std::monostate, RideRequest, VehicleOffer, PassengerHandoff> payload = {}; // as noted by the message code
 };
 
 }  // namespace rideshare
 
-#endif  // SIMPLE_MESSAGE_H_
\ No newline at end of file
+#endif  // SIMPLE_MESSAGE_H_
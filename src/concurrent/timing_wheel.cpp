@@ -0,0 +1,81 @@
+/**
+ * @file timing_wheel.cpp
+ * @brief Implementation of arming, cancelling and expiring timers in a hierarchical timing wheel.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "timing_wheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <vector>
+
+namespace rideshare {
+
+TimingWheel::TimingWheel(int tick_ms) :
+                         slots_(SLOTS_ * LEVELS_), START_(std::chrono::steady_clock::now()), TICK_MS_(tick_ms) {}
+
+void TimingWheel::Arm(int id, int delay_ms) {
+    Cancel(id);
+    uint64_t ticks = std::max((delay_ms + TICK_MS_ - 1) / TICK_MS_, 1);
+    Insert(id, current_tick_ + ticks);
+}
+
+void TimingWheel::Cancel(int id) {
+    auto timer = timers_.find(id);
+    if (timer == timers_.end()) {
+        return;
+    }
+    slots_[timer->second.slot].erase(timer->second.position);
+    timers_.erase(timer);
+}
+
+void TimingWheel::Insert(int id, uint64_t expiry) {
+    // Hold any expiry past the top wheel at the furthest tick it reaches
+    const uint64_t max_delta = (1ULL << (SLOT_BITS_ * LEVELS_)) - 1;
+    uint64_t delta = std::min(expiry - std::min(expiry, current_tick_), max_delta);
+    expiry = current_tick_ + delta;
+    // The lowest wheel whose full turn covers the delay, so the slot comes round before (or at) the expiry
+    int level = 0;
+    while (level < LEVELS_ - 1 && delta >= (1ULL << (SLOT_BITS_ * (level + 1)))) {
+        ++level;
+    }
+    int slot = (level * SLOTS_) + ((expiry >> (SLOT_BITS_ * level)) & (SLOTS_ - 1));
+    slots_[slot].emplace_back(id);
+    timers_[id] = { .expiry = expiry, .slot = slot, .position = std::prev(slots_[slot].end()) };
+}
+
+void TimingWheel::Cascade(int level) {
+    std::list<int> cascading;
+    cascading.swap(slots_[(level * SLOTS_) + ((current_tick_ >> (SLOT_BITS_ * level)) & (SLOTS_ - 1))]);
+    for (int id : cascading) {
+        Insert(id, timers_.at(id).expiry);
+    }
+}
+
+std::vector<int> TimingWheel::Advance(std::chrono::steady_clock::time_point now) {
+    std::vector<int> expired;
+    uint64_t target = std::chrono::duration_cast<std::chrono::milliseconds>(now - START_).count() / TICK_MS_;
+    while (current_tick_ < target) {
+        ++current_tick_;
+        // As each wheel completes a turn, bring down the next slot of the one above it, from the top down
+        for (int level = LEVELS_ - 1; level > 0; --level) {
+            if ((current_tick_ & ((1ULL << (SLOT_BITS_ * level)) - 1)) == 0) {
+                Cascade(level);
+            }
+        }
+        std::list<int> &slot = slots_[current_tick_ & (SLOTS_ - 1)];
+        for (int id : slot) {
+            expired.emplace_back(id);
+            timers_.erase(id);
+        }
+        slot.clear();
+    }
+    return expired;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,68 @@
+/**
+ * @file timing_wheel.h
+ * @brief Hierarchical timing wheel, for many timers per thread that are cheap to arm and cancel.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef TIMING_WHEEL_H_
+#define TIMING_WHEEL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace rideshare {
+
+// Timers are kept by id, in one of LEVELS_ wheels of SLOTS_ slots each. The lowest wheel has a slot per tick,
+//  and each higher wheel a slot per full turn of the one below it, so arming and cancelling are O(1) no
+//  matter how many timers there are, and a timer is only touched again as its wheel turns down to the next.
+//  Not thread-safe; meant to be owned by the thread that arms and advances it.
+class TimingWheel {
+  public:
+    // Constructor / Destructor
+    // Each tick is `tick_ms` long, starting from now
+    explicit TimingWheel(int tick_ms);
+
+    // Getters
+    bool Armed(int id) const { return timers_.count(id) == 1; }
+    size_t Size() const { return timers_.size(); }
+
+    // Set a timer to expire `delay_ms` from now (rounded up to a tick), replacing any already set for the id.
+    //  Delays past the reach of the wheels are held at their furthest tick
+    void Arm(int id, int delay_ms);
+    // Remove any timer for the id
+    void Cancel(int id);
+    // Turn the wheels up to `now`, returning ids of the timers that expired in the order they expired
+    std::vector<int> Advance(std::chrono::steady_clock::time_point now);
+
+  private:
+    // Where a timer is, so it can be taken out of its slot without searching it
+    struct Timer {
+        uint64_t expiry; // tick
+        int slot;        // index into slots_, across all levels
+        std::list<int>::iterator position;
+    };
+    // Put a timer in the slot of the lowest wheel that reaches its expiry
+    void Insert(int id, uint64_t expiry);
+    // Move the timers in a slot of a higher wheel down into lower ones, as the current tick reaches it
+    void Cascade(int level);
+
+    // Member variables
+    static constexpr int SLOT_BITS_ = 6;
+    static constexpr int SLOTS_ = 1 << SLOT_BITS_; // per wheel
+    static constexpr int LEVELS_ = 4; // so reaching SLOTS_^LEVELS_ ticks, e.g. ~46 hours at 10 ms ticks
+    std::vector<std::list<int>> slots_; // ids, level by level
+    std::unordered_map<int, Timer> timers_; // id, where its timer is
+    uint64_t current_tick_ = 0; // last tick expired
+    const std::chrono::steady_clock::time_point START_;
+    const int TICK_MS_;
+};
+
+}  // namespace rideshare
+
+#endif  // TIMING_WHEEL_H_
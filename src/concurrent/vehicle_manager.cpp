@@ -8,20 +8,28 @@
 
 #include "vehicle_manager.h"
 
+#include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "ride_matcher.h"
+#include "simple_message.h"
 #include "mapping/coordinate.h"
 #include "mapping/route_model.h"
+#include "map_object/object_pool.h"
 #include "map_object/passenger.h"
 #include "map_object/vehicle.h"
+#include "routing/road_graph.h"
 #include "routing/route_planner.h"
 
 namespace rideshare {
 
 VehicleManager::VehicleManager(RouteModel *model,
                                std::shared_ptr<RoutePlanner> route_planner,
-                               int max_objects) : ObjectHolder(model, route_planner, max_objects) {
+                               int max_objects, int capacity) :
+                               ObjectHolder(model, route_planner, max_objects), CAPACITY_(capacity),
+                               fleet_size_(max_objects), MIN_FLEET_(max_objects / 2), MAX_FLEET_(2 * max_objects) {
     // Set distance per cycle based on model's latitudes
     distance_per_cycle_ = std::abs(model_->MaxLat() - model->MinLat()) / 1000.0;
     // Generate max number of vehicles at the start
@@ -31,19 +39,22 @@ VehicleManager::VehicleManager(RouteModel *model,
 }
 
 void VehicleManager::GenerateNew() {
-    // Get random start position
-    auto start = model_->GetRandomMapPosition();
+    // Start from a random position
+    GenerateAt(model_->GetRandomMapPosition());
+}
+
+void VehicleManager::GenerateAt(const Coordinate &start) {
     // Set a random destination until they have a passenger to go pick up
     auto destination = model_->GetRandomMapPosition();
     // Find the nearest road node to start and destination positions
-    auto nearest_start = model_->FindClosestNode(start);
-    auto nearest_dest = model_->FindClosestNode(destination);
-    // Set road position, destination and id of vehicle
-    std::shared_ptr<Vehicle> vehicle = std::make_shared<Vehicle>(distance_per_cycle_);
+    const RoadGraph &graph = route_planner_->Graph();
+    const Model::Node &nearest_start = graph.Position(graph.NearestNode(start));
+    const Model::Node &nearest_dest = graph.Position(graph.NearestNode(destination));
+    // Set road position, destination and id of vehicle, pooled as vehicles come and go with the fleet size
+    std::shared_ptr<Vehicle> vehicle = MakePooled<Vehicle>(distance_per_cycle_, CAPACITY_);
     vehicle->SetPosition((Coordinate){.x = nearest_start.x, .y = nearest_start.y});
     vehicle->SetDestination((Coordinate){.x = nearest_dest.x, .y = nearest_dest.y});
-    vehicle->SetId(idCnt_++);
-    vehicles_.emplace(vehicle->Id(), vehicle);
+    AddVehicle(vehicle);
     // Output id and location of vehicle looking to give rides
     std::lock_guard<std::mutex> lck(mtx_);
     std::cout << "Vehicle #" << idCnt_ - 1 << " now driving from: " << nearest_start.y << ", " << nearest_start.x << "." << std::endl;
@@ -57,7 +68,8 @@ void VehicleManager::ResetVehicleDestination(std::shared_ptr<Vehicle> vehicle, b
     } else {
         destination = vehicle->GetDestination();
     }
-    auto nearest_dest = model_->FindClosestNode(destination);
+    const RoadGraph &graph = route_planner_->Graph();
+    const Model::Node &nearest_dest = graph.Position(graph.NearestNode(destination));
     vehicle->SetDestination((Coordinate){.x = nearest_dest.x, .y = nearest_dest.y});
 }
 
@@ -69,12 +81,15 @@ void VehicleManager::Simulate() {
 void VehicleManager::Drive() {
     while (true) {
         // Sleep at every iteration to reduce CPU usage
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::this_thread::sleep_for(std::chrono::milliseconds((int)CYCLE_MS_));
 
+        ++cycle_;
         // Pick up any available passengers first
         PickUpPassengers();
-        // Assign any new matches
+        // Assign any new matches, then move any vehicles still idle
         NewPassengerAssignments();
+        NewRebalanceMoves();
+        NewFleetChanges();
 
         // Drive the vehicles
         for (auto & [id, vehicle] : vehicles_) {
@@ -85,6 +100,14 @@ void VehicleManager::Drive() {
                     if (vehicle->State() == VehicleState::no_passenger_requested || vehicle->State() == VehicleState::no_passenger_queued) {
                         SimpleVehicleFailure(vehicle);
                         continue;
+                    } else if (vehicle->State() == VehicleState::passenger_queued) {
+                        // Can't reach the next pick up after a previous stop
+                        AssignmentFailure(vehicle, vehicle->Stops().front().passenger_id);
+                        continue;
+                    } else if (vehicle->State() == VehicleState::driving_passenger) {
+                        // Can't reach the next drop off, so let the passenger out here instead
+                        DropOffPassenger(vehicle);
+                        continue;
                     }
                 }
             }
@@ -100,6 +123,8 @@ void VehicleManager::Drive() {
             } else {
                 // Drive to current destination
                 vehicle->IncrementalMove();
+                ChainDispatch(vehicle);
+                UpdateOffer(vehicle);
             }
 
             // Check if at destination
@@ -120,6 +145,11 @@ void VehicleManager::Drive() {
         // Remove any vehicles that had issues on the map
         if (to_remove_.size() > 0) {
             for (int id : to_remove_) {
+                // The same vehicle may have been queued more than once this cycle (e.g. to exit the fleet and
+                //  also after failing to move), so skip any already erased
+                if (vehicles_.find(id) == vehicles_.end()) {
+                    continue;
+                }
                 // Notify ride matcher (doesn't matter for no request state or driving, but does for others)
                 ride_matcher_->Message({ .message_code=RideMatcher::vehicle_is_ineligible, .id=id });
                 // Erase the vehicle
@@ -129,11 +159,40 @@ void VehicleManager::Drive() {
             to_remove_.clear();
         }
 
-        // Make sure to keep max vehicles on the road
-        if (vehicles_.size() < MAX_OBJECTS_) {
+        // Make sure to keep the fleet size on the road
+        if ((int)vehicles_.size() < fleet_size_) {
             GenerateNew();
         }
+
+        // Let readers (e.g. graphics) see this cycle's positions
+        PublishSnapshot();
+    }
+}
+
+void VehicleManager::PublishSnapshot() {
+    // Pick a stable subset of vehicles by id to include paths for, sized by the largest the fleet can grow to
+    //  so the subset doesn't change as the fleet grows and shrinks
+    int path_stride = 1 + (MAX_FLEET_ - 1) / MAX_PUBLISHED_PATHS_;
+    for (auto & [id, vehicle] : vehicles_) {
+        AddToSnapshot(*vehicle, AgentKind::vehicle_agent, vehicle->State(), vehicle->Shape(), vehicle->Shape());
+        // Note the road segment being driven, between the last path node reached and the next one
+        const std::vector<int> &path_nodes = vehicle->PathNodes();
+        int path_index = vehicle->PathIndex();
+        if (path_index > 0 && path_index < (int)path_nodes.size()) {
+            snapshot_.agents.back().edge_from = path_nodes.at(path_index - 1);
+            snapshot_.agents.back().edge_to = path_nodes.at(path_index);
+        }
+        if (publish_paths_ && id % path_stride == 0 && path_index < (int)path_nodes.size()) {
+            snapshot_.agents.back().path_offset = snapshot_.path_nodes.size();
+            snapshot_.agents.back().path_count = path_nodes.size() - path_index;
+            snapshot_.path_nodes.insert(snapshot_.path_nodes.end(), path_nodes.begin() + path_index, path_nodes.end());
+        }
+        for (auto &passenger : vehicle->Passengers()) {
+            AddToSnapshot(*passenger, AgentKind::riding_passenger, passenger->GetStatus(),
+                          passenger->PassShape(), passenger->DestShape());
+        }
     }
+    FinishSnapshot();
 }
 
 void VehicleManager::SimpleVehicleFailure(std::shared_ptr<Vehicle> vehicle) {
@@ -157,58 +216,220 @@ void VehicleManager::RequestPassenger(std::shared_ptr<Vehicle> vehicle) {
     vehicle->SetState(VehicleState::no_passenger_queued);
     // Request the passenger from the ride matcher
     if (ride_matcher_ != nullptr) {
-        ride_matcher_->Message({ .message_code=RideMatcher::vehicle_requests_passenger, .id=vehicle->Id() });
+        ride_matcher_->Message({ .message_code=RideMatcher::vehicle_requests_passenger, .id=vehicle->Id(),
+                                 .payload=Offer(vehicle) });
     }
 }
 
-void VehicleManager::AssignPassenger(int id, Coordinate position) {
-    std::lock_guard<std::mutex> lck(new_assignment_locations_mutex);
-    // Add the newly assigned passenger pickup position for later use
-    new_assignment_locations.emplace(id, position);
+void VehicleManager::AddVehicle(std::shared_ptr<Vehicle> vehicle) {
+    vehicle->SetId(idCnt_++);
+    vehicles_.emplace(vehicle->Id(), vehicle);
+}
+
+void VehicleManager::AssignPassenger(int id, StopInsertion insertion) {
+    std::lock_guard<std::mutex> lck(new_assignments_mutex);
+    // Add the newly assigned passenger stops for later use
+    new_assignments_.emplace_back(id, insertion);
 }
 
 void VehicleManager::NewPassengerAssignments() {
     // Lock and copy over the new assignments so can release the mutex faster
-    std::unique_lock<std::mutex> lck(new_assignment_locations_mutex);
-    std::unordered_map<int, Coordinate> copied_assignments(new_assignment_locations);
-    // Clear out the new assignment locations and unlock
-    new_assignment_locations.clear();
+    std::unique_lock<std::mutex> lck(new_assignments_mutex);
+    std::vector<std::pair<int, StopInsertion>> copied_assignments(new_assignments_);
+    // Clear out the new assignments and unlock
+    new_assignments_.clear();
     lck.unlock();
 
-    // Loop through an assign passenger pick up locations to related vehicles
-    for (auto [id, position] : copied_assignments) {
+    // Loop through and add passenger stops to related vehicles
+    for (auto [id, insertion] : copied_assignments) {
+        if (vehicles_.count(id) == 0) {
+            // Vehicle already left the map; the ride matcher fails its passengers once notified
+            continue;
+        }
         auto vehicle = vehicles_.at(id);
-        // Store current position
-        Coordinate curr_pos = vehicle->GetPosition();
-        // Set position for use with route to passenger as the next node on the path
-        // Avoids potential issue if current position is closest to an unreachable node
-        if (vehicle->Path().empty()) {
-            // Empty path likely a result of failure, so don't progress with assignment
-            AssignmentFailure(vehicle);
-            return;
+        // Any offer made before its drop off has now been taken
+        ClearChainOffer(vehicle);
+        // Only need a new route if the pick up is now the next stop
+        if (!vehicle->InsertStops(insertion)) {
+            continue;
         }
-        Model::Node next_node = vehicle->Path().at(vehicle->PathIndex());
-        vehicle->SetPosition({ .x = next_node.x, .y = next_node.y });
-        // Set new vehicle destination and update its state
-        vehicle->SetDestination(position);
-        ResetVehicleDestination(vehicle, false); // Aligns to route node
-        // Get the path to the passenger
-        route_planner_->AStarSearch(vehicle);
-        // Set position back to original to keep smooth route
-        vehicle->SetPosition(curr_pos);
-        // Make sure path is not empty (unreachable), then update the state
-        if (vehicle->Path().empty()) {
-            AssignmentFailure(vehicle);
-        } else {
+        if (Reroute(vehicle, vehicle->Stops().front().location)) {
             // Update state when done processing
             vehicle->SetState(VehicleState::passenger_queued);
+        } else {
+            AssignmentFailure(vehicle, insertion.pickup.passenger_id);
+        }
+    }
+}
+
+bool VehicleManager::Reroute(std::shared_ptr<Vehicle> vehicle, const Coordinate &destination) {
+    if (vehicle->Path().empty()) {
+        // Empty path likely a result of failure, so don't progress with assignment
+        return false;
+    }
+    // Store current position
+    Coordinate curr_pos = vehicle->GetPosition();
+    // Set position for use with route to the destination as the next node on the path
+    // Avoids potential issue if current position is closest to an unreachable node
+    if (vehicle->PathIndex() < (int)vehicle->Path().size()) {
+        Model::Node next_node = vehicle->Path().at(vehicle->PathIndex());
+        vehicle->SetPosition({ .x = next_node.x, .y = next_node.y });
+    }
+    // Set new vehicle destination
+    vehicle->SetDestination(destination);
+    ResetVehicleDestination(vehicle, false); // Aligns to route node
+    // Get the path to the destination
+    route_planner_->AStarSearch(vehicle);
+    // Set position back to original to keep smooth route
+    vehicle->SetPosition(curr_pos);
+    // Make sure path is not empty (unreachable)
+    return !vehicle->Path().empty();
+}
+
+void VehicleManager::RebalanceVehicles(const std::vector<std::pair<int, Coordinate>> &moves) {
+    std::lock_guard<std::mutex> lck(rebalance_moves_mutex);
+    // Add the moves for later use, replacing any not yet made
+    rebalance_moves_ = moves;
+}
+
+void VehicleManager::NewRebalanceMoves() {
+    // Lock and move out the rebalance moves so can release the mutex faster
+    std::unique_lock<std::mutex> lck(rebalance_moves_mutex);
+    std::vector<std::pair<int, Coordinate>> moves;
+    moves.swap(rebalance_moves_);
+    lck.unlock();
+
+    for (const auto & [id, destination] : moves) {
+        // Only move vehicles still idle; any matched since the snapshot was taken keep their passengers
+        auto found = vehicles_.find(id);
+        if (found == vehicles_.end() || found->second->State() != VehicleState::no_passenger_queued ||
+            !found->second->Stops().empty()) {
+            continue;
+        }
+        if (!Reroute(found->second, destination)) {
+            // Fall back to cruising as before
+            ResetVehicleDestination(found->second, true);
+        }
+    }
+}
+
+void VehicleManager::AdjustFleet(const std::vector<Coordinate> &entries, const std::vector<int> &exits) {
+    std::lock_guard<std::mutex> lck(fleet_changes_mutex);
+    // Replace any changes not yet made, as these are based on newer supply and demand
+    fleet_entries_ = entries;
+    fleet_exits_ = exits;
+}
+
+void VehicleManager::NewFleetChanges() {
+    // Lock and move out the fleet changes so can release the mutex faster
+    std::unique_lock<std::mutex> lck(fleet_changes_mutex);
+    std::vector<Coordinate> entries;
+    std::vector<int> exits;
+    entries.swap(fleet_entries_);
+    exits.swap(fleet_exits_);
+    lck.unlock();
+
+    for (int id : exits) {
+        // Only vehicles still idle leave; any matched since keep their passengers
+        auto found = vehicles_.find(id);
+        if (fleet_size_ <= MIN_FLEET_ || found == vehicles_.end() ||
+            found->second->State() != VehicleState::no_passenger_queued || !found->second->Stops().empty() ||
+            std::find(to_remove_.begin(), to_remove_.end(), id) != to_remove_.end()) {
+            continue;
+        }
+        --fleet_size_;
+        to_remove_.emplace_back(id);
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << "Vehicle #" << id << " is leaving map, with more vehicles than riders." << std::endl;
+    }
+    for (const Coordinate &entry : entries) {
+        if (fleet_size_ >= MAX_FLEET_) {
+            break;
+        }
+        ++fleet_size_;
+        GenerateAt(entry);
+    }
+}
+
+void VehicleManager::ChainDispatch(const std::shared_ptr<Vehicle> &vehicle) {
+    // Only when driving to the last drop off; pooled vehicles are already matched along the way
+    if (chain_distance_ <= 0.0 || CAPACITY_ > 1 || vehicle->State() != VehicleState::driving_passenger ||
+        vehicle->Stops().size() != 1) {
+        return;
+    }
+    // Already offered, with UpdateOffer keeping the ride matcher's copy of the offer up to date
+    if (vehicle->ChainRequested() || vehicle->RemainingDistance() > chain_distance_) {
+        return;
+    }
+    vehicle->SetChainRequested(true);
+    if (ride_matcher_ != nullptr) {
+        ride_matcher_->Message({ .message_code=RideMatcher::vehicle_requests_passenger, .id=vehicle->Id(),
+                                 .payload=Offer(vehicle) });
+    }
+}
+
+void VehicleManager::UpdateOffer(const std::shared_ptr<Vehicle> &vehicle) {
+    // Only for vehicles offered with nowhere to be, or on the way to a drop off, spread out by id so a few
+    //  are sent each cycle
+    if (ride_matcher_ == nullptr || (cycle_ + vehicle->Id()) % OFFER_UPDATE_CYCLES_ != 0) {
+        return;
+    }
+    bool idle = vehicle->State() == VehicleState::no_passenger_queued && vehicle->Stops().empty();
+    bool chained = vehicle->ChainRequested() && vehicle->State() == VehicleState::driving_passenger;
+    if (!idle && !chained) {
+        return;
+    }
+    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_moved, .id=vehicle->Id(), .payload=Offer(vehicle) });
+}
+
+void VehicleManager::ClearChainOffer(std::shared_ptr<Vehicle> vehicle) {
+    if (!vehicle->ChainRequested()) {
+        return;
+    }
+    vehicle->SetChainRequested(false);
+}
+
+VehicleOffer VehicleManager::Offer(const std::shared_ptr<Vehicle> &vehicle) {
+    VehicleOffer offer = { .position = vehicle->GetPosition() };
+    if (vehicle->ChainRequested() && vehicle->State() == VehicleState::driving_passenger && !vehicle->Stops().empty()) {
+        const Stop &dropoff = vehicle->Stops().front();
+        offer.chained_passenger_id = dropoff.passenger_id;
+        offer.dropoff = dropoff.location;
+        offer.remaining = vehicle->RemainingDistance();
+    }
+    return offer;
+}
+
+void VehicleManager::NextStop(std::shared_ptr<Vehicle> vehicle) {
+    if (vehicle->Stops().empty()) {
+        // Find a new random destination
+        ResetVehicleDestination(vehicle, true);
+        // Transition back to no passenger requested state, unless already offered before this drop off
+        bool offered = vehicle->ChainRequested();
+        vehicle->SetState(offered ? VehicleState::no_passenger_queued : VehicleState::no_passenger_requested);
+        ClearChainOffer(vehicle);
+        if (offered && ride_matcher_ != nullptr) {
+            // Still offered, but now free from right here
+            ride_matcher_->Message({ .message_code=RideMatcher::vehicle_moved, .id=vehicle->Id(), .payload=Offer(vehicle) });
         }
+        return;
     }
+    // Head for the next stop, routed next cycle
+    const Stop &next = vehicle->Stops().front();
+    vehicle->SetDestination(next.location);
+    ResetVehicleDestination(vehicle, false); // Aligns to route node
+    vehicle->SetState(next.pickup ? VehicleState::passenger_queued : VehicleState::driving_passenger);
 }
 
-void VehicleManager::AssignmentFailure(std::shared_ptr<Vehicle> vehicle) {
+void VehicleManager::AssignmentFailure(std::shared_ptr<Vehicle> vehicle, int p_id) {
     // Notify ride matcher of failure
-    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_cannot_reach_passenger, .id=vehicle->Id() });
+    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_cannot_reach_passenger, .id=p_id });
+    // Drop the passenger's stops, and continue on with any others
+    vehicle->RemoveStops(p_id);
+    if (!vehicle->Stops().empty()) {
+        NextStop(vehicle);
+        return;
+    }
     // Set state to nothing requested so it will make a new request
     vehicle->SetState(VehicleState::no_passenger_requested);
     // Add to vehicle failures
@@ -219,20 +440,20 @@ void VehicleManager::AssignmentFailure(std::shared_ptr<Vehicle> vehicle) {
 void VehicleManager::ArrivedAtPassenger(std::shared_ptr<Vehicle> vehicle) {
     // Transition to waiting
     vehicle->SetState(VehicleState::waiting);
-    // Notify ride matcher
-    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_has_arrived, .id=vehicle->Id() });
+    // Notify ride matcher of which passenger's pick up was reached
+    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_has_arrived, .id=vehicle->Stops().front().passenger_id });
 }
 
 void VehicleManager::PassengerIntoVehicle(int id, std::shared_ptr<Passenger> passenger) {
     std::lock_guard<std::mutex> pickups_lock(passenger_pickups_mutex);
-    // Add to passenger pickups map
-    passenger_pickups_.emplace(id, passenger);
+    // Add to passenger pickups
+    passenger_pickups_.emplace_back(id, passenger);
 }
 
 void VehicleManager::PickUpPassengers() {
     // Lock and copy over the passenger pickups so can release the mutex faster
     std::unique_lock<std::mutex> pickups_lock(passenger_pickups_mutex);
-    std::unordered_map<int, std::shared_ptr<Passenger>> copied_pickups(passenger_pickups_);
+    std::vector<std::pair<int, std::shared_ptr<Passenger>>> copied_pickups(passenger_pickups_);
     // Clear out the passenger pickups and unlock
     passenger_pickups_.clear();
     pickups_lock.unlock();
@@ -244,25 +465,24 @@ void VehicleManager::PickUpPassengers() {
         std::unique_lock<std::mutex> lck(mtx_);
         std::cout << "Vehicle #" << vehicle->Id() << " picked up Passenger #" << passenger->Id() << "." << std::endl;
         lck.unlock();
-        // Set passenger into vehicle
-        vehicle->SetPassenger(passenger); // Vehicle handles setting new destination with passenger
-        ResetVehicleDestination(vehicle, false); // Aligns to route node
-        // Update state when done processing
-        vehicle->SetState(VehicleState::driving_passenger);
+        // Set passenger into vehicle, then head for the next stop (at least the passenger's own drop off)
+        vehicle->PickUpPassenger(passenger);
+        NextStop(vehicle);
     }
 }
 
 void VehicleManager::DropOffPassenger(std::shared_ptr<Vehicle> vehicle) {
+    int p_id = vehicle->Stops().front().passenger_id;
     // Output notice to console
     std::unique_lock<std::mutex> lck(mtx_);
-    std::cout << "Vehicle #" << vehicle->Id() << " dropped off Passenger #" << vehicle->GetPassenger()->Id() << "." << std::endl;
+    std::cout << "Vehicle #" << vehicle->Id() << " dropped off Passenger #" << p_id << "." << std::endl;
     lck.unlock();
     // Drop off the passenger
-    vehicle->DropOffPassenger();
-    // Find a new random destination
-    ResetVehicleDestination(vehicle, true);
-    // Transition back to no passenger requested state
-    vehicle->SetState(VehicleState::no_passenger_requested);
+    vehicle->DropOffPassenger(p_id);
+    // Let the ride matcher know the seat is free again
+    ride_matcher_->Message({ .message_code=RideMatcher::vehicle_dropped_off, .id=p_id });
+    // Continue to the next stop, or a new random destination if done
+    NextStop(vehicle);
 }
 
 }  // namespace rideshare
@@ -9,12 +9,15 @@
 #ifndef VEHICLE_MANAGER_H_
 #define VEHICLE_MANAGER_H_
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "concurrent_object.h"
+#include "message_handler.h"
 #include "object_holder.h"
 #include "mapping/coordinate.h"
 #include "mapping/route_model.h"
@@ -22,34 +25,55 @@
 #include "map_object/vehicle.h"
 #include "routing/route_planner.h"
 
-// Avoid circular includes
-namespace rideshare {
-    class RideMatcher;
-}
-
 namespace rideshare {
 
 class VehicleManager : public ConcurrentObject, public ObjectHolder {
   public:
     // Constructor / Destructor
-    VehicleManager(RouteModel *model, std::shared_ptr<RoutePlanner> route_planner, int max_objects);
+    VehicleManager(RouteModel *model, std::shared_ptr<RoutePlanner> route_planner, int max_objects, int capacity);
     
     // Getters / Setters
     const std::unordered_map<int, std::shared_ptr<Vehicle>>& Vehicles() { return vehicles_; }
-    void SetRideMatcher(std::shared_ptr<RideMatcher> ride_matcher) { ride_matcher_ = ride_matcher; }
+    // Fewest and most vehicles there can be at once, as the fleet can shrink or grow from the starting max
+    int MinFleet() { return MIN_FLEET_; }
+    int MaxFleet() { return MAX_FLEET_; }
+    // Vehicles currently meant to be on the road, safe to read from other threads
+    int FleetSize() { return fleet_size_; }
+    // Receives RideMatcher message codes, whether a single ride matcher or a router to zones of them
+    void SetRideMatcher(std::shared_ptr<MessageHandler> ride_matcher) { ride_matcher_ = ride_matcher; }
+    // Include remaining paths in snapshots, for a limited subset of vehicles if there are many
+    void SetPublishPaths(bool publish_paths) { publish_paths_ = publish_paths; }
+    // Offer single-passenger vehicles for their next passenger once within `chain_ms` of a drop off (0 never does)
+    void SetChainDispatch(int chain_ms) { chain_distance_ = distance_per_cycle_ * chain_ms / CYCLE_MS_; }
 
     // Concurrent simulation
     void Simulate();
 
+    // Add a vehicle already placed on a road (e.g. a synthetic fleet), giving it an id but skipping
+    //  the nearest road search of generation. Only safe before Simulate, or from the manager's own thread
+    void AddVehicle(std::shared_ptr<Vehicle> vehicle);
+
     // Passenger-related handling
-    // Receive any new passenger assignments
-    void AssignPassenger(int id, Coordinate position);
+    // Receive any new passenger assignments, as where to add their stops into the vehicle's plan
+    void AssignPassenger(int id, StopInsertion insertion);
     // Receive any passengers ready to be picked up by specified vehicle its post-arrival
     void PassengerIntoVehicle(int id, std::shared_ptr<Passenger> passenger);
 
+    // Rebalancing
+    // Receive new destinations for idle vehicles, as (vehicle id, destination) pairs
+    void RebalanceVehicles(const std::vector<std::pair<int, Coordinate>> &moves);
+    // Receive positions for new vehicles to enter at, and ids of vehicles to leave if still idle
+    void AdjustFleet(const std::vector<Coordinate> &entries, const std::vector<int> &exits);
+
   private:
     // Creation
     void GenerateNew();
+    // Generate a vehicle starting from the road nearest to the given position
+    void GenerateAt(const Coordinate &start);
+    // Add and remove vehicles as last asked to, within the fleet size limits
+    void NewFleetChanges();
+    // Publish vehicles, and any passengers riding in them, for readers on other threads
+    void PublishSnapshot();
 
     // Movement
     // Handle loop cycle of movements and actions based on assignments / arrival at passengers
@@ -58,29 +82,61 @@ class VehicleManager : public ConcurrentObject, public ObjectHolder {
     void ResetVehicleDestination(std::shared_ptr<Vehicle> vehicle, bool random);
     // Vehicle has encountered some type of issue reaching a given destination, without a passenger within
     void SimpleVehicleFailure(std::shared_ptr<Vehicle> vehicle);
+    // Head to the next planned stop, or a random destination if none, updating state to match
+    void NextStop(std::shared_ptr<Vehicle> vehicle);
+    // Route to a new destination right away, so the vehicle turns smoothly from its current path; false if unreachable
+    bool Reroute(std::shared_ptr<Vehicle> vehicle, const Coordinate &destination);
+    // Send any vehicles still idle toward their new rebalancing destinations
+    void NewRebalanceMoves();
+    // Offer a vehicle for its next passenger once close enough to its drop off (UpdateOffer then keeps it up to date)
+    void ChainDispatch(const std::shared_ptr<Vehicle> &vehicle);
+    // Every OFFER_UPDATE_CYCLES_, let the ride matcher know where an offered vehicle has moved to (and how far
+    //  it still has to go, if on the way to a drop off)
+    void UpdateOffer(const std::shared_ptr<Vehicle> &vehicle);
+    // Done with any offer made while on the way to a drop off
+    void ClearChainOffer(std::shared_ptr<Vehicle> vehicle);
+    // A vehicle's offer as of now, including its drop off if offered on the way to one
+    VehicleOffer Offer(const std::shared_ptr<Vehicle> &vehicle);
 
     // Passenger-related handling
     // Request a passenger to pick up from the ride matcher
     void RequestPassenger(std::shared_ptr<Vehicle> vehicle);
-    // Notify specified vehicle of passenger assignment, given the passenger's current position
+    // Add new passenger assignments into the specified vehicles' planned stops
     void NewPassengerAssignments();
-    // Handle aspects of being unable to reach a matched passenger (notify ride matcher, re-request, add a simple failure)
-    void AssignmentFailure(std::shared_ptr<Vehicle> vehicle);
-    // Notify ride matcher that vehicle arrived at node nearest to passenger position
+    // Handle aspects of being unable to reach a matched passenger (notify ride matcher, drop its stops,
+    //  then continue with any other stops, or re-request and add a simple failure)
+    void AssignmentFailure(std::shared_ptr<Vehicle> vehicle, int p_id);
+    // Notify ride matcher that vehicle arrived at node nearest to the next passenger's position
     void ArrivedAtPassenger(std::shared_ptr<Vehicle> vehicle);
     // Pick up any passengers now ready to be picked up post-arrival
     void PickUpPassengers();
-    // Drop off the passenger once nearest node to its destination is reached (remove from vehicle)
+    // Drop off the next stop's passenger once nearest node to its destination is reached (remove from vehicle)
     void DropOffPassenger(std::shared_ptr<Vehicle> vehicle);
 
     // Variables
     std::unordered_map<int, std::shared_ptr<Vehicle>> vehicles_;
-    std::unordered_map<int, std::shared_ptr<Passenger>> passenger_pickups_; // store passenger pickups for next cycle
-    std::unordered_map<int, Coordinate> new_assignment_locations; // store new assignments for next cycle
+    // Store passenger pickups and new assignments for next cycle, in order, as a vehicle may have several
+    std::vector<std::pair<int, std::shared_ptr<Passenger>>> passenger_pickups_;
+    std::vector<std::pair<int, StopInsertion>> new_assignments_;
+    std::vector<std::pair<int, Coordinate>> rebalance_moves_;
+    std::vector<Coordinate> fleet_entries_;
+    std::vector<int> fleet_exits_;
     std::vector<int> to_remove_; // store vehicle ids of those to remove the next cycle (due to too many failures)
-    std::shared_ptr<RideMatcher> ride_matcher_;
+    const int CAPACITY_; // max passengers riding in each vehicle at once
+    std::atomic<int> fleet_size_; // vehicles to keep on the road, starting from MAX_OBJECTS_
+    const int MIN_FLEET_; // half of MAX_OBJECTS_
+    const int MAX_FLEET_; // twice MAX_OBJECTS_
+    bool publish_paths_ = false;
+    double chain_distance_ = 0.0; // offer a vehicle this close to its drop off for its next passenger
+    const double CYCLE_MS_ = 10.0; // sleep between each driving cycle
+    long cycle_ = 0; // driving cycles so far
+    const int OFFER_UPDATE_CYCLES_ = 50; // cycles between updates of each offered vehicle's position to the ride matcher
+    const int MAX_PUBLISHED_PATHS_ = 50; // if the fleet can grow beyond this many vehicles, only publish paths of every n-th id
+    std::shared_ptr<MessageHandler> ride_matcher_;
     std::mutex passenger_pickups_mutex; // protect read/write access to passenger pickups between cycles
-    std::mutex new_assignment_locations_mutex; // protect read/write access to new assignments between cycles
+    std::mutex new_assignments_mutex; // protect read/write access to new assignments between cycles
+    std::mutex rebalance_moves_mutex; // protect read/write access to rebalance moves between cycles
+    std::mutex fleet_changes_mutex; // protect read/write access to fleet entries and exits between cycles
 };
 
 }  // namespace rideshare
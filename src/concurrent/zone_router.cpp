@@ -0,0 +1,195 @@
+/**
+ * @file zone_router.cpp
+ * @brief Implementation of routing ride matcher messages to the ride matcher of each zone.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "zone_router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <variant>
+
+namespace rideshare {
+
+ZoneRouter::ZoneRouter(std::shared_ptr<PassengerQueue> passenger_queue, std::shared_ptr<VehicleManager> vehicle_manager,
+                       const Model &model, std::string match_type, const RoadGraph &road_graph, int capacity,
+                       int zones_per_side) :
+                       passenger_queue_(passenger_queue), vehicle_manager_(vehicle_manager),
+                       ZONES_PER_SIDE_(zones_per_side), MIN_X_(model.MinLon()), MIN_Y_(model.MinLat()),
+                       ZONE_WIDTH_((model.MaxLon() - model.MinLon()) / zones_per_side),
+                       ZONE_HEIGHT_((model.MaxLat() - model.MinLat()) / zones_per_side) {
+    // Each zone still matches with the whole map's sense of distance, as vehicles can come from anywhere
+    const double MAP_DIM = (std::abs(model.MaxLat() - model.MinLat()) + std::abs(model.MaxLon() - model.MinLon())) / 2.0;
+    for (int zone = 0; zone < ZONES_PER_SIDE_ * ZONES_PER_SIDE_; ++zone) {
+        zones_.emplace_back(std::make_shared<RideMatcher>(passenger_queue, vehicle_manager, MAP_DIM, match_type,
+                                                          road_graph, capacity));
+        // A single zone has nowhere else to hand passengers off to
+        if (ZONES_PER_SIDE_ > 1) {
+            zones_.back()->SetZoneRouter(this);
+        }
+    }
+}
+
+void ZoneRouter::SetMatchWindow(int window_ms, int window_requests) {
+    for (auto &zone : zones_) {
+        zone->SetMatchWindow(window_ms, window_requests);
+    }
+}
+
+void ZoneRouter::SetMetrics(const std::shared_ptr<Metrics> &metrics) {
+    for (auto &zone : zones_) {
+        zone->SetMetrics(metrics);
+    }
+}
+
+void ZoneRouter::SetMarket(const std::shared_ptr<Market> &market) {
+    for (auto &zone : zones_) {
+        zone->SetMarket(market);
+    }
+}
+
+void ZoneRouter::Simulate() {
+    for (auto &zone : zones_) {
+        zone->Simulate();
+    }
+}
+
+int ZoneRouter::ZoneOf(const Coordinate &position) const {
+    int column = std::clamp((int)((position.x - MIN_X_) / ZONE_WIDTH_), 0, ZONES_PER_SIDE_ - 1);
+    int row = std::clamp((int)((position.y - MIN_Y_) / ZONE_HEIGHT_), 0, ZONES_PER_SIDE_ - 1);
+    return (row * ZONES_PER_SIDE_) + column;
+}
+
+int ZoneRouter::ChooseZone(const Coordinate &position) const {
+    int home = ZoneOf(position);
+    int home_row = home / ZONES_PER_SIDE_, home_column = home % ZONES_PER_SIDE_;
+    int best = home;
+    int best_supply = zones_.at(home)->OpenVehicles();
+
+    // Near a border, the closest vehicle may well be across it, so prefer whichever side has more of them
+    for (int row = std::max(home_row - 1, 0); row <= std::min(home_row + 1, ZONES_PER_SIDE_ - 1); ++row) {
+        for (int column = std::max(home_column - 1, 0); column <= std::min(home_column + 1, ZONES_PER_SIDE_ - 1); ++column) {
+            double min_x = MIN_X_ + (column * ZONE_WIDTH_), min_y = MIN_Y_ + (row * ZONE_HEIGHT_);
+            double dx = std::max({ min_x - position.x, position.x - (min_x + ZONE_WIDTH_), 0.0 });
+            double dy = std::max({ min_y - position.y, position.y - (min_y + ZONE_HEIGHT_), 0.0 });
+            int zone = (row * ZONES_PER_SIDE_) + column;
+            if (dx > ZONE_WIDTH_ * BORDER_FRACTION_ || dy > ZONE_HEIGHT_ * BORDER_FRACTION_) {
+                continue;
+            }
+            int supply = zones_.at(zone)->OpenVehicles();
+            if (supply > best_supply) {
+                best = zone;
+                best_supply = supply;
+            }
+        }
+    }
+    if (best_supply > 0) {
+        return best;
+    }
+
+    // No open vehicles nearby, so fall back to the nearest zone with any
+    double best_distance = std::numeric_limits<double>::max();
+    for (int zone = 0; zone < (int)zones_.size(); ++zone) {
+        if (zones_.at(zone)->OpenVehicles() == 0) {
+            continue;
+        }
+        double center_x = MIN_X_ + (((zone % ZONES_PER_SIDE_) + 0.5) * ZONE_WIDTH_);
+        double center_y = MIN_Y_ + (((zone / ZONES_PER_SIDE_) + 0.5) * ZONE_HEIGHT_);
+        double distance = std::hypot(center_x - position.x, center_y - position.y);
+        if (distance < best_distance) {
+            best = zone;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+void ZoneRouter::Message(SimpleMessage simple_message) {
+    std::lock_guard<std::mutex> lck(zones_mutex_);
+    int id = simple_message.id;
+    switch (simple_message.message_code) {
+        case RideMatcher::MsgCodes::passenger_handed_off:
+            if (passenger_zones_.count(id) == 0) {
+                // Already left the queue, after the zone sent them back
+                return;
+            }
+            // Otherwise a new request, from wherever they are now best matched
+            simple_message.message_code = RideMatcher::MsgCodes::passenger_requests_ride;
+            [[fallthrough]];
+        case RideMatcher::MsgCodes::passenger_requests_ride: {
+            auto request = std::get_if<RideRequest>(&simple_message.payload);
+            if (request == nullptr) {
+                return;
+            }
+            int zone = ChooseZone(request->position);
+            auto previous = passenger_zones_.find(id);
+            if (previous != passenger_zones_.end() && previous->second != zone) {
+                // Only ever waiting in one zone, so the last one forgets them (they have no match there by now)
+                Forward(previous->second, { .message_code = RideMatcher::MsgCodes::passenger_leaves_zone, .id = id });
+            }
+            passenger_zones_[id] = zone;
+            Forward(zone, simple_message);
+            break;
+        }
+        case RideMatcher::MsgCodes::vehicle_requests_passenger: {
+            auto vehicle_offer = std::get_if<VehicleOffer>(&simple_message.payload);
+            if (vehicle_offer == nullptr) {
+                return;
+            }
+            // Vehicles are offered where they are (or will be, if still on the way to a drop off),
+            //  as only passengers are handed between zones
+            int zone = ZoneOf((vehicle_offer->chained_passenger_id != -1) ? vehicle_offer->dropoff : vehicle_offer->position);
+            auto previous = vehicle_zones_.find(id);
+            if (previous != vehicle_zones_.end() && previous->second != zone) {
+                // A pooled vehicle may still be offered where it last requested
+                Forward(previous->second, { .message_code = RideMatcher::MsgCodes::vehicle_leaves_zone, .id = id });
+            }
+            vehicle_zones_[id] = zone;
+            Forward(zone, simple_message);
+            break;
+        }
+        case RideMatcher::MsgCodes::vehicle_moved: {
+            // Stays offered in the zone it requested in until its next request, as zones match from anywhere
+            auto zone = vehicle_zones_.find(id);
+            if (zone != vehicle_zones_.end()) {
+                Forward(zone->second, simple_message);
+            }
+            break;
+        }
+        case RideMatcher::MsgCodes::vehicle_is_ineligible:
+            // Pooled passengers matched in other zones may still be riding with it, so tell every zone
+            for (auto &zone : zones_) {
+                zone->Message(simple_message);
+            }
+            vehicle_zones_.erase(id);
+            break;
+        case RideMatcher::MsgCodes::vehicle_cannot_reach_passenger:
+        case RideMatcher::MsgCodes::vehicle_has_arrived:
+        case RideMatcher::MsgCodes::passenger_to_vehicle:
+        case RideMatcher::MsgCodes::vehicle_dropped_off:
+        case RideMatcher::MsgCodes::passenger_is_ineligible: {
+            auto zone = passenger_zones_.find(id);
+            if (zone == passenger_zones_.end()) {
+                // Never requested, so no zone knows of them
+                return;
+            }
+            Forward(zone->second, simple_message);
+            // Done with the passenger once dropped off or removed
+            if (simple_message.message_code == RideMatcher::MsgCodes::vehicle_dropped_off ||
+                simple_message.message_code == RideMatcher::MsgCodes::passenger_is_ineligible) {
+                passenger_zones_.erase(zone);
+            }
+            break;
+        }
+        default:
+            // Invalid message (or only sent between the router and zones), ignore
+            break;
+    }
+}
+
+}  // namespace rideshare
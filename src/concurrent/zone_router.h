@@ -0,0 +1,75 @@
+/**
+ * @file zone_router.h
+ * @brief Splits ride matching across a grid of geographic zones, each matched by its own ride matcher thread.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef ZONE_ROUTER_H_
+#define ZONE_ROUTER_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "message_handler.h"
+#include "passenger_queue.h"
+#include "ride_matcher.h"
+#include "simple_message.h"
+#include "vehicle_manager.h"
+#include "dispatch/market.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+#include "metrics/metrics.h"
+#include "routing/road_graph.h"
+
+namespace rideshare {
+
+class ZoneRouter : public MessageHandler {
+  public:
+    // Constructor / Destructor
+    // Split the map into `zones_per_side` x `zones_per_side` zones, each with a ride matcher set up as given
+    ZoneRouter(std::shared_ptr<PassengerQueue> passenger_queue, std::shared_ptr<VehicleManager> vehicle_manager,
+               const Model &model, std::string match_type, const RoadGraph &road_graph, int capacity,
+               int zones_per_side);
+
+    // Setters, applied to every zone's ride matcher
+    void SetMatchWindow(int window_ms, int window_requests);
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics);
+    void SetMarket(const std::shared_ptr<Market> &market);
+
+    // Concurrent simulation, starting each zone's ride matcher
+    void Simulate();
+
+    // Message receiving, with RideMatcher message codes, passed on right away to the ride matcher of the related zone.
+    //  Requests go to the zone they're made in, and later passenger messages to whichever zone matched them
+    void Message(SimpleMessage simple_message);
+
+  private:
+    // Zone a position is in
+    int ZoneOf(const Coordinate &position) const;
+    // Zone to match a passenger in: their own, unless near a neighboring zone with more open vehicles,
+    //  or else the nearest zone with any open vehicles if there are none nearby
+    int ChooseZone(const Coordinate &position) const;
+    // Send a message to the given zone's ride matcher
+    void Forward(int zone, SimpleMessage simple_message) { zones_.at(zone)->Message(simple_message); }
+
+    // Member variables
+    std::shared_ptr<PassengerQueue> passenger_queue_;
+    std::shared_ptr<VehicleManager> vehicle_manager_;
+    std::vector<std::shared_ptr<RideMatcher>> zones_; // row-major, starting from min lat/lon
+    std::unordered_map<int, int> passenger_zones_; // p_id, zone matching them
+    std::unordered_map<int, int> vehicle_zones_;   // v_id, zone offering them
+    std::mutex zones_mutex_; // protect the maps above, as messages come from several threads
+    const int ZONES_PER_SIDE_;
+    const double MIN_X_, MIN_Y_;
+    const double ZONE_WIDTH_, ZONE_HEIGHT_;
+    const double BORDER_FRACTION_ = 0.1; // Fraction of a zone's size to be near its border with another
+};
+
+}  // namespace rideshare
+
+#endif  // ZONE_ROUTER_H_
@@ -0,0 +1,84 @@
+/**
+ * @file assignment.cpp
+ * @brief Implementation of the Hungarian algorithm, with potentials, in O(rows^2 * columns).
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "assignment.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace rideshare {
+
+std::vector<int> MinCostAssignment(const std::vector<double> &costs, int rows, int columns) {
+    // Solved with no more rows than columns, so swap the two if needed
+    bool transposed = rows > columns;
+    int n = transposed ? columns : rows;
+    int m = transposed ? rows : columns;
+    auto cost = [&](int i, int j) { return transposed ? costs[(j * columns) + i] : costs[(i * columns) + j]; };
+
+    // 1-indexed, with index 0 as a placeholder column; row_of[j] is the row assigned to column j
+    const double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> row_potential(n + 1, 0.0), column_potential(m + 1, 0.0), min_slack(m + 1);
+    std::vector<int> row_of(m + 1, 0), previous_column(m + 1, 0);
+    std::vector<bool> used(m + 1);
+    for (int i = 1; i <= n; ++i) {
+        // Grow an alternating path from row i until it reaches a free column
+        row_of[0] = i;
+        int column = 0;
+        std::fill(min_slack.begin(), min_slack.end(), INF);
+        std::fill(used.begin(), used.end(), false);
+        do {
+            used[column] = true;
+            int row = row_of[column], next_column = 0;
+            double delta = INF;
+            for (int j = 1; j <= m; ++j) {
+                if (used[j]) {
+                    continue;
+                }
+                double slack = cost(row - 1, j - 1) - row_potential[row] - column_potential[j];
+                if (slack < min_slack[j]) {
+                    min_slack[j] = slack;
+                    previous_column[j] = column;
+                }
+                if (min_slack[j] < delta) {
+                    delta = min_slack[j];
+                    next_column = j;
+                }
+            }
+            for (int j = 0; j <= m; ++j) {
+                if (used[j]) {
+                    row_potential[row_of[j]] += delta;
+                    column_potential[j] -= delta;
+                } else {
+                    min_slack[j] -= delta;
+                }
+            }
+            column = next_column;
+        } while (row_of[column] != 0);
+        // Flip the path, so row i is assigned and every other row on it moves over a column
+        do {
+            int previous = previous_column[column];
+            row_of[column] = row_of[previous];
+            column = previous;
+        } while (column != 0);
+    }
+
+    std::vector<int> assigned(rows, -1);
+    for (int j = 1; j <= m; ++j) {
+        if (row_of[j] != 0) {
+            if (transposed) {
+                assigned[j - 1] = row_of[j] - 1;
+            } else {
+                assigned[row_of[j] - 1] = j - 1;
+            }
+        }
+    }
+    return assigned;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,23 @@
+/**
+ * @file assignment.h
+ * @brief Minimum total cost one-to-one assignment of rows to columns (the Hungarian algorithm).
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef ASSIGNMENT_H_
+#define ASSIGNMENT_H_
+
+#include <vector>
+
+namespace rideshare {
+
+// Assign each row of a row-major `rows` x `columns` cost matrix to a different column, for the lowest total cost.
+//  Returns the column of each row, or -1 for rows left over when there are fewer columns than rows.
+//  Pairs that must not be assigned can be given a cost far above any real one, and checked for afterward
+std::vector<int> MinCostAssignment(const std::vector<double> &costs, int rows, int columns);
+
+}  // namespace rideshare
+
+#endif  // ASSIGNMENT_H_
@@ -0,0 +1,49 @@
+/**
+ * @file demand_forecast.cpp
+ * @brief Implementation of gridding requests and exponentially smoothing them into a forecast.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "demand_forecast.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+DemandForecast::DemandForecast(double min_x, double min_y, double max_x, double max_y,
+                               int cells_per_side, double smoothing) :
+                               MIN_X_(min_x), MIN_Y_(min_y),
+                               CELL_WIDTH_(std::max(max_x - min_x, 1e-9) / cells_per_side),
+                               CELL_HEIGHT_(std::max(max_y - min_y, 1e-9) / cells_per_side),
+                               CELLS_PER_SIDE_(cells_per_side), SMOOTHING_(smoothing),
+                               requests_(cells_per_side * cells_per_side, 0),
+                               forecast_(cells_per_side * cells_per_side, 0.0) {}
+
+int DemandForecast::Cell(const Coordinate &position) const {
+    int column = std::clamp((int)((position.x - MIN_X_) / CELL_WIDTH_), 0, CELLS_PER_SIDE_ - 1);
+    int row = std::clamp((int)((position.y - MIN_Y_) / CELL_HEIGHT_), 0, CELLS_PER_SIDE_ - 1);
+    return (row * CELLS_PER_SIDE_) + column;
+}
+
+Coordinate DemandForecast::CellCenter(int cell) const {
+    int column = cell % CELLS_PER_SIDE_;
+    int row = cell / CELLS_PER_SIDE_;
+    return (Coordinate){ .x = MIN_X_ + ((column + 0.5) * CELL_WIDTH_), .y = MIN_Y_ + ((row + 0.5) * CELL_HEIGHT_) };
+}
+
+void DemandForecast::EndInterval() {
+    // Exponential smoothing, starting from the first interval as is
+    double weight = started_ ? SMOOTHING_ : 1.0;
+    for (size_t c = 0; c < forecast_.size(); ++c) {
+        forecast_[c] = (weight * requests_[c]) + ((1.0 - weight) * forecast_[c]);
+    }
+    std::fill(requests_.begin(), requests_.end(), 0);
+    started_ = true;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,52 @@
+/**
+ * @file demand_forecast.h
+ * @brief Counts ride requests in a uniform grid over the map, smoothed over time into a per-cell demand forecast.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef DEMAND_FORECAST_H_
+#define DEMAND_FORECAST_H_
+
+#include <vector>
+
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+class DemandForecast {
+  public:
+    // Constructor / Destructor
+    // Grid of `cells_per_side` squared cells over the given bounds. `smoothing` is the weight (0-1)
+    //  of the latest interval's requests against the forecast so far
+    DemandForecast(double min_x, double min_y, double max_x, double max_y, int cells_per_side, double smoothing);
+
+    // Getters
+    int CellCount() const { return CELLS_PER_SIDE_ * CELLS_PER_SIDE_; }
+    int CellsPerSide() const { return CELLS_PER_SIDE_; }
+    // Expected requests per interval in each cell
+    const std::vector<double> &Forecast() const { return forecast_; }
+    // Cell containing a position, clamped to the grid
+    int Cell(const Coordinate &position) const;
+    Coordinate CellCenter(int cell) const;
+
+    // Count a request made during the current interval
+    void AddRequest(const Coordinate &position) { ++requests_[Cell(position)]; }
+    // Fold the current interval's requests into the forecast, and start counting a new interval
+    void EndInterval();
+
+  private:
+    // Member variables
+    const double MIN_X_, MIN_Y_;
+    const double CELL_WIDTH_, CELL_HEIGHT_;
+    const int CELLS_PER_SIDE_;
+    const double SMOOTHING_;
+    std::vector<int> requests_; // this interval
+    std::vector<double> forecast_;
+    bool started_ = false; // whether the forecast has any intervals yet
+};
+
+}  // namespace rideshare
+
+#endif  // DEMAND_FORECAST_H_
@@ -0,0 +1,159 @@
+/**
+ * @file market.cpp
+ * @brief Implementation of per-zone supply and demand, kept up to date from events rather than by scanning agents.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "market.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "concurrent/vehicle_manager.h"
+#include "dispatch/demand_forecast.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+
+namespace rideshare {
+
+Market::Market(const Model &model, std::shared_ptr<VehicleManager> vehicle_manager, int interval_ms) :
+               vehicle_manager_(vehicle_manager),
+               zones_(model.MinLon(), model.MinLat(), model.MaxLon(), model.MaxLat(), ZONES_PER_SIDE_, SMOOTHING_),
+               waiting_(zones_.CellCount(), 0), open_vehicles_(zones_.CellCount()), surges_(zones_.CellCount()),
+               INTERVAL_(interval_ms) {
+    for (auto &surge : surges_) {
+        surge = 1.0;
+    }
+}
+
+void Market::Record(const Event &event) {
+    std::lock_guard<std::mutex> lck(events_mutex_);
+    events_.emplace_back(event);
+}
+
+void Market::Simulate() {
+    // Launch Update function in a thread
+    threads.emplace_back(std::thread(&Market::Update, this));
+}
+
+void Market::Update() {
+    auto last_update = std::chrono::steady_clock::now();
+    while (true) {
+        // Sleep at every iteration to reduce CPU usage
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        // Keep the counts current, even though prices and the fleet change less often
+        ApplyEvents();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_update >= std::chrono::milliseconds(INTERVAL_)) {
+            last_update = now;
+            EndInterval();
+        }
+    }
+}
+
+void Market::ApplyEvents() {
+    // Lock and move out the events so can release the mutex faster
+    std::unique_lock<std::mutex> lck(events_mutex_);
+    std::vector<Event> events;
+    events.swap(events_);
+    lck.unlock();
+
+    for (const Event &event : events) {
+        // Every event first takes the agent out of wherever it was counted, so repeats are harmless
+        if (event.kind == vehicle_opened || event.kind == vehicle_closed) {
+            auto counted = vehicle_zones_.find(event.id);
+            if (counted != vehicle_zones_.end()) {
+                open_vehicles_[counted->second].erase(event.id);
+                vehicle_zones_.erase(counted);
+            }
+            if (event.kind == vehicle_opened) {
+                int zone = zones_.Cell(event.position);
+                open_vehicles_[zone].emplace(event.id);
+                vehicle_zones_.emplace(event.id, zone);
+            }
+        } else {
+            auto counted = passenger_zones_.find(event.id);
+            bool already_waiting = counted != passenger_zones_.end();
+            if (already_waiting) {
+                --waiting_[counted->second];
+                passenger_zones_.erase(counted);
+            }
+            if (event.kind == request_opened) {
+                int zone = zones_.Cell(event.position);
+                ++waiting_[zone];
+                passenger_zones_.emplace(event.id, zone);
+                // Re-requests (e.g. after a failure or from another zone) aren't new demand
+                if (!already_waiting) {
+                    zones_.AddRequest(event.position);
+                }
+            }
+        }
+    }
+}
+
+void Market::EndInterval() {
+    zones_.EndInterval();
+    const std::vector<double> &forecast = zones_.Forecast();
+    const int zone_count = zones_.CellCount();
+
+    // Demand counts those already waiting, plus those expected to request before the next update
+    std::vector<double> excess_demand(zone_count);
+    double total_demand = 0.0, total_supply = 0.0, max_surge = 1.0;
+    for (int zone = 0; zone < zone_count; ++zone) {
+        double demand = waiting_[zone] + forecast[zone];
+        double supply = open_vehicles_[zone].size();
+        excess_demand[zone] = demand - supply;
+        total_demand += demand;
+        total_supply += supply;
+        double surge = std::clamp(demand / std::max(supply, 1.0), 1.0, MAX_SURGE_);
+        surges_[zone] = ((1.0 - SMOOTHING_) * surges_[zone]) + (SMOOTHING_ * surge);
+        max_surge = std::max(max_surge, surges_[zone].load());
+    }
+
+    // Bring in vehicles, one at a time where demand most outstrips supply
+    std::vector<Coordinate> entries;
+    int entering = std::min({ MAX_FLEET_STEP_, (int)std::floor(total_demand - total_supply),
+                              vehicle_manager_->MaxFleet() - vehicle_manager_->FleetSize() });
+    for (int i = 0; i < entering; ++i) {
+        int zone = std::max_element(excess_demand.begin(), excess_demand.end()) - excess_demand.begin();
+        entries.emplace_back(zones_.CellCenter(zone));
+        excess_demand[zone] -= 1.0;
+    }
+    // Or retire idle vehicles, one at a time where supply most outstrips demand
+    std::vector<int> exits;
+    int leaving = std::min({ MAX_FLEET_STEP_, (int)std::floor((total_supply - (EXIT_RATIO_ * total_demand)) / 2.0),
+                             vehicle_manager_->FleetSize() - vehicle_manager_->MinFleet() });
+    std::vector<std::set<int>::iterator> next_exit(zone_count);
+    for (int zone = 0; zone < zone_count; ++zone) {
+        next_exit[zone] = open_vehicles_[zone].begin();
+    }
+    for (int i = 0; i < leaving; ++i) {
+        int zone = std::min_element(excess_demand.begin(), excess_demand.end()) - excess_demand.begin();
+        if (next_exit[zone] == open_vehicles_[zone].end()) {
+            break;
+        }
+        exits.emplace_back(*next_exit[zone]++);
+        excess_demand[zone] += 1.0;
+    }
+    if (!entries.empty() || !exits.empty()) {
+        vehicle_manager_->AdjustFleet(entries, exits);
+    }
+
+    if (metrics_ != nullptr) {
+        metrics_->Record("market_supply_demand", total_supply / std::max(total_demand, 1.0));
+        metrics_->Record("market_max_surge", max_surge);
+        metrics_->Record("market_fleet_size", vehicle_manager_->FleetSize());
+        metrics_->Increment("market_entries", entries.size());
+        metrics_->Increment("market_exits", exits.size());
+    }
+}
+
+}  // namespace rideshare
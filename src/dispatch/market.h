@@ -0,0 +1,88 @@
+/**
+ * @file market.h
+ * @brief Tracks supply and demand per zone from ride matching events, pricing surges and resizing the fleet.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef MARKET_H_
+#define MARKET_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "concurrent/concurrent_object.h"
+#include "concurrent/vehicle_manager.h"
+#include "dispatch/demand_forecast.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+#include "metrics/metrics.h"
+
+namespace rideshare {
+
+class Market : public ConcurrentObject {
+  public:
+    // Changes to the pools of waiting passengers and open vehicles, as made by the ride matcher(s)
+    enum EventKind {
+        request_opened,     // passenger id, with their position
+        request_closed,     // passenger id, matched, removed or gave up waiting
+        vehicle_opened,     // vehicle id, with its position
+        vehicle_closed,     // vehicle id, matched or removed
+    };
+    struct Event {
+        EventKind kind;
+        int id;
+        Coordinate position; // only needed when opened
+    };
+
+    // Constructor / Destructor
+    // Update every `interval_ms`, adding or retiring vehicles through the vehicle manager
+    Market(const Model &model, std::shared_ptr<VehicleManager> vehicle_manager, int interval_ms);
+
+    // Getters / Setters
+    // Price multiplier in the zone containing a position, from 1 (none) up to MAX_SURGE_
+    double Surge(const Coordinate &position) const { return surges_.at(zones_.Cell(position)); }
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+
+    // Receive an event, from any thread, to apply on the next cycle
+    void Record(const Event &event);
+
+    // Concurrent simulation
+    void Simulate();
+
+  private:
+    // Handles loop cycle of applying events, and updating prices and the fleet each interval
+    void Update();
+    // Apply events to the counts of waiting passengers and open vehicles per zone
+    void ApplyEvents();
+    // Price each zone by demand (waiting plus forecast requests) over open vehicles, and bring vehicles
+    //  in where demand most outstrips them, or retire idle ones where there are far more than needed
+    void EndInterval();
+
+    // Member variables
+    std::shared_ptr<VehicleManager> vehicle_manager_;
+    DemandForecast zones_; // gives the zone grid, and forecasts requests in each zone
+    std::vector<Event> events_;
+    std::mutex events_mutex_; // protect events_ between recording threads and the market
+    std::vector<int> waiting_; // passengers waiting in each zone
+    std::vector<std::set<int>> open_vehicles_; // ids of vehicles open to a match in each zone
+    std::unordered_map<int, int> passenger_zones_; // p_id, zone counted in
+    std::unordered_map<int, int> vehicle_zones_;   // v_id, zone counted in
+    std::vector<std::atomic<double>> surges_; // read from other threads, e.g. when generating passengers
+    std::shared_ptr<Metrics> metrics_;
+    const int INTERVAL_; // ms between each update
+    static constexpr int ZONES_PER_SIDE_ = 4;
+    static constexpr double SMOOTHING_ = 0.5; // weight of the latest interval in forecasts and surges
+    static constexpr double MAX_SURGE_ = 3.0;
+    static constexpr double EXIT_RATIO_ = 2.0; // retire vehicles only once open vehicles are this many times demand
+    static constexpr int MAX_FLEET_STEP_ = 5; // most vehicles to add or retire each interval
+};
+
+}  // namespace rideshare
+
+#endif  // MARKET_H_
@@ -0,0 +1,122 @@
+/**
+ * @file min_cost_flow.cpp
+ * @brief Implementation of primal-dual min-cost flow.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "min_cost_flow.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace rideshare {
+
+static const long UNREACHED = std::numeric_limits<long>::max();
+
+int MinCostFlow::AddEdge(int from, int to, int capacity, long cost) {
+    int index = edges_.size();
+    edges_.push_back({ to, capacity, 0, cost });
+    edges_from_[from].emplace_back(index);
+    edges_.push_back({ from, 0, 0, -cost });
+    edges_from_[to].emplace_back(index + 1);
+    return index;
+}
+
+bool MinCostFlow::ShortestPaths(int source, int sink) {
+    std::fill(distances_.begin(), distances_.end(), UNREACHED);
+    using QueueEntry = std::pair<long, int>; // distance, node
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+    distances_[source] = 0;
+    open.emplace(0, source);
+    while (!open.empty()) {
+        auto [distance, node] = open.top();
+        open.pop();
+        if (distance > distances_[node]) {
+            continue;
+        }
+        for (int e : edges_from_[node]) {
+            const Edge &edge = edges_[e];
+            if (edge.flow >= edge.capacity) {
+                continue;
+            }
+            // Never negative, given potentials from the previous search
+            long next_distance = distance + ReducedCost(e);
+            if (next_distance < distances_[edge.to]) {
+                distances_[edge.to] = next_distance;
+                open.emplace(next_distance, edge.to);
+            }
+        }
+    }
+    return distances_[sink] != UNREACHED;
+}
+
+bool MinCostFlow::Levels(int source, int sink) {
+    std::fill(levels_.begin(), levels_.end(), -1);
+    std::queue<int> open;
+    levels_[source] = 0;
+    open.emplace(source);
+    while (!open.empty()) {
+        int node = open.front();
+        open.pop();
+        for (int e : edges_from_[node]) {
+            const Edge &edge = edges_[e];
+            if (edge.flow < edge.capacity && levels_[edge.to] == -1 && ReducedCost(e) == 0) {
+                levels_[edge.to] = levels_[node] + 1;
+                open.emplace(edge.to);
+            }
+        }
+    }
+    return levels_[sink] != -1;
+}
+
+int MinCostFlow::Augment(int node, int sink, int limit) {
+    if (node == sink) {
+        return limit;
+    }
+    for (size_t &i = next_edges_[node]; i < edges_from_[node].size(); ++i) {
+        int e = edges_from_[node][i];
+        const Edge &edge = edges_[e];
+        if (edge.flow >= edge.capacity || levels_[edge.to] != levels_[node] + 1 || ReducedCost(e) != 0) {
+            continue;
+        }
+        int pushed = Augment(edge.to, sink, std::min(limit, edge.capacity - edge.flow));
+        if (pushed > 0) {
+            edges_[e].flow += pushed;
+            edges_[e ^ 1].flow -= pushed;
+            total_cost_ += pushed * edges_[e].cost;
+            return pushed;
+        }
+    }
+    return 0;
+}
+
+int MinCostFlow::Solve(int source, int sink, int max_flow) {
+    // Costs start non-negative, so all-zero potentials are valid for the first search
+    std::fill(potentials_.begin(), potentials_.end(), 0);
+    int flow = 0;
+    while (flow < max_flow && ShortestPaths(source, sink)) {
+        // Update potentials so every edge on a cheapest path to the sink has zero reduced cost. Capping
+        //  at the sink's distance keeps reduced costs non-negative for nodes beyond it, or unreached
+        for (size_t node = 0; node < potentials_.size(); ++node) {
+            potentials_[node] += std::min(distances_[node], distances_[sink]);
+        }
+        // Push a blocking flow along all of those cheapest paths before searching again
+        while (flow < max_flow && Levels(source, sink)) {
+            std::fill(next_edges_.begin(), next_edges_.end(), 0);
+            int pushed;
+            while (flow < max_flow && (pushed = Augment(source, sink, max_flow - flow)) > 0) {
+                flow += pushed;
+            }
+        }
+    }
+    return flow;
+}
+
+}  // namespace rideshare
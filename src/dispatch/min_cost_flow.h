@@ -0,0 +1,65 @@
+/**
+ * @file min_cost_flow.h
+ * @brief Min-cost flow over a small directed graph, by primal-dual: shortest path distances (with node potentials)
+ *  decide which edges are on a cheapest path, then a blocking flow is pushed along all of them at once.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef MIN_COST_FLOW_H_
+#define MIN_COST_FLOW_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace rideshare {
+
+class MinCostFlow {
+  public:
+    // Constructor / Destructor
+    MinCostFlow(int node_count) : edges_from_(node_count), potentials_(node_count), distances_(node_count),
+                                  levels_(node_count), next_edges_(node_count) {};
+
+    // Add a directed edge with non-negative cost, returning its index for reading its flow afterward
+    int AddEdge(int from, int to, int capacity, long cost);
+    // Send up to `max_flow` from source to sink at the lowest total cost, returning the flow sent
+    int Solve(int source, int sink, int max_flow);
+
+    // Getters
+    int Flow(int edge) const { return edges_[edge].flow; }
+    int EdgeFrom(int edge) const { return edges_[edge ^ 1].to; }
+    int EdgeTo(int edge) const { return edges_[edge].to; }
+    long TotalCost() const { return total_cost_; }
+
+  private:
+    // Each edge is stored next to its residual reverse, so edge ^ 1 is always the other of the pair
+    struct Edge {
+        int to;
+        int capacity;
+        int flow;
+        long cost;
+    };
+
+    // Cost of an edge relative to the node potentials; zero if on a cheapest path from the source
+    long ReducedCost(int edge) const { return edges_[edge].cost + potentials_[edges_[edge ^ 1].to] - potentials_[edges_[edge].to]; }
+    // Dijkstra's algorithm over residual edges with reduced costs, returning whether the sink was reached
+    bool ShortestPaths(int source, int sink);
+    // Breadth-first levels over residual edges on cheapest paths, returning whether the sink was reached
+    bool Levels(int source, int sink);
+    // Push up to `limit` along a single path of increasing levels, returning the amount pushed
+    int Augment(int node, int sink, int limit);
+
+    // Member variables
+    std::vector<Edge> edges_;
+    std::vector<std::vector<int>> edges_from_; // edge indices leaving each node
+    std::vector<long> potentials_; // keep reduced costs non-negative between searches
+    std::vector<long> distances_;
+    std::vector<int> levels_;
+    std::vector<size_t> next_edges_; // next of each node's edges to try, so dead ends aren't re-tried
+    long total_cost_ = 0;
+};
+
+}  // namespace rideshare
+
+#endif  // MIN_COST_FLOW_H_
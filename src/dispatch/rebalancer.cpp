@@ -0,0 +1,211 @@
+/**
+ * @file rebalancer.cpp
+ * @brief Implementation of forecasting demand per grid cell, and solving a min-cost flow of idle vehicles toward it.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "rebalancer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+#include "concurrent/vehicle_manager.h"
+#include "dispatch/demand_forecast.h"
+#include "dispatch/min_cost_flow.h"
+#include "map_object/vehicle.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+
+namespace rideshare {
+
+Rebalancer::Rebalancer(const Model &model, std::shared_ptr<VehicleManager> vehicle_manager,
+                       SnapshotBuffer *passenger_snapshots, SnapshotBuffer *vehicle_snapshots, int interval_ms) :
+                       vehicle_manager_(vehicle_manager), passenger_snapshots_(passenger_snapshots),
+                       vehicle_snapshots_(vehicle_snapshots),
+                       forecast_(model.MinLon(), model.MinLat(), model.MaxLon(), model.MaxLat(),
+                                 GRID_CELLS_PER_SIDE_, SMOOTHING_),
+                       INTERVAL_(interval_ms) {}
+
+void Rebalancer::Simulate() {
+    // Launch Rebalance function in a thread
+    threads.emplace_back(std::thread(&Rebalancer::Rebalance, this));
+}
+
+void Rebalancer::Rebalance() {
+    auto last_rebalance = std::chrono::steady_clock::now();
+    while (true) {
+        // Sleep at every iteration to reduce CPU usage
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        // Keep up with every request, even though rebalancing is less frequent
+        CountRequests();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_rebalance >= std::chrono::milliseconds(INTERVAL_)) {
+            last_rebalance = now;
+            forecast_.EndInterval();
+            MoveIdleVehicles();
+        }
+    }
+}
+
+void Rebalancer::CountRequests() {
+    if (!passenger_snapshots_->Read(passengers_)) {
+        return;
+    }
+    int newest = last_request_id_;
+    for (const AgentState &agent : passengers_.agents) {
+        if (agent.kind == AgentKind::waiting_passenger && agent.id > last_request_id_) {
+            forecast_.AddRequest(agent.position);
+            newest = std::max(newest, agent.id);
+        }
+    }
+    last_request_id_ = newest;
+}
+
+void Rebalancer::MoveIdleVehicles() {
+    vehicle_snapshots_->Read(vehicles_);
+    auto start = std::chrono::steady_clock::now();
+
+    // Idle vehicles have asked for a passenger and are only cruising until one is matched
+    std::vector<std::pair<int, Coordinate>> idle;
+    for (const AgentState &agent : vehicles_.agents) {
+        if (agent.kind == AgentKind::vehicle_agent && agent.state == VehicleState::no_passenger_queued) {
+            idle.emplace_back(agent.id, agent.position);
+        }
+    }
+    auto moves = PlanMoves(forecast_, idle);
+    if (!moves.empty()) {
+        vehicle_manager_->RebalanceVehicles(moves);
+    }
+
+    if (metrics_ != nullptr) {
+        metrics_->Record("rebalance_ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        metrics_->Increment("rebalance_moves", moves.size());
+    }
+}
+
+std::vector<std::pair<int, Coordinate>> Rebalancer::PlanMoves(const DemandForecast &forecast,
+                                                              const std::vector<std::pair<int, Coordinate>> &idle) {
+    std::vector<std::pair<int, Coordinate>> moves;
+    const std::vector<double> &demand = forecast.Forecast();
+    double total_demand = 0.0;
+    for (double cell_demand : demand) {
+        total_demand += cell_demand;
+    }
+    if (idle.empty() || total_demand <= 0.0) {
+        return moves;
+    }
+
+    // Idle vehicles in each cell
+    const int cells = forecast.CellCount();
+    std::vector<std::vector<int>> idle_in_cell(cells);
+    for (const auto & [id, position] : idle) {
+        idle_in_cell[forecast.Cell(position)].emplace_back(id);
+    }
+
+    // Each cell's target share of idle vehicles: whole vehicles first, then any left over by largest remainder
+    std::vector<int> target(cells);
+    std::vector<std::pair<double, int>> remainders; // remainder, cell
+    int assigned = 0;
+    for (int c = 0; c < cells; ++c) {
+        double share = idle.size() * demand[c] / total_demand;
+        target[c] = (int)share;
+        assigned += target[c];
+        if (share > target[c]) {
+            remainders.emplace_back(share - target[c], c);
+        }
+    }
+    std::sort(remainders.begin(), remainders.end(), std::greater<std::pair<double, int>>());
+    for (size_t r = 0; assigned < (int)idle.size() && r < remainders.size(); ++r, ++assigned) {
+        ++target[remainders[r].second];
+    }
+
+    // Flow on the grid itself, from surplus cells to deficit cells, one unit of cost per cell crossed.
+    //  Neighboring cells only, rather than every surplus to every deficit, keeps the graph small at any fleet size
+    const int side = forecast.CellsPerSide();
+    const int source = cells, sink = cells + 1;
+    MinCostFlow flow(cells + 2);
+    const int unlimited = idle.size();
+    std::vector<int> grid_edges;
+    for (int c = 0; c < cells; ++c) {
+        int column = c % side, row = c / side;
+        if (column + 1 < side) {
+            grid_edges.emplace_back(flow.AddEdge(c, c + 1, unlimited, 1));
+            grid_edges.emplace_back(flow.AddEdge(c + 1, c, unlimited, 1));
+        }
+        if (row + 1 < side) {
+            grid_edges.emplace_back(flow.AddEdge(c, c + side, unlimited, 1));
+            grid_edges.emplace_back(flow.AddEdge(c + side, c, unlimited, 1));
+        }
+        int supply = idle_in_cell[c].size();
+        if (supply > target[c]) {
+            flow.AddEdge(source, c, supply - target[c], 0);
+        } else if (supply < target[c]) {
+            flow.AddEdge(c, sink, target[c] - supply, 0);
+        }
+    }
+    int total = flow.Solve(source, sink, idle.size());
+    if (total == 0) {
+        return moves;
+    }
+
+    // Break the flow down into vehicle moves: walk each surplus cell's flow along the grid until it reaches
+    //  a deficit cell, then send that many of the cell's idle vehicles there
+    std::vector<std::vector<int>> out_edges(cells); // grid edges with flow left to walk, per cell
+    std::vector<int> remaining_flow(grid_edges.size());
+    for (size_t g = 0; g < grid_edges.size(); ++g) {
+        remaining_flow[g] = flow.Flow(grid_edges[g]);
+        if (remaining_flow[g] > 0) {
+            out_edges[flow.EdgeFrom(grid_edges[g])].emplace_back(g);
+        }
+    }
+    std::vector<int> deficit(cells, 0);
+    for (int c = 0; c < cells; ++c) {
+        deficit[c] = std::max(0, target[c] - (int)idle_in_cell[c].size());
+    }
+    for (int c = 0; c < cells; ++c) {
+        int surplus = std::max(0, (int)idle_in_cell[c].size() - target[c]);
+        while (surplus > 0 && !out_edges[c].empty()) {
+            // Follow edges with flow left until a cell still short of vehicles, carrying the smallest flow along the way
+            int cell = c, amount = surplus;
+            std::vector<int> walked;
+            while (deficit[cell] == 0 && (int)walked.size() < cells) {
+                while (!out_edges[cell].empty() && remaining_flow[out_edges[cell].back()] == 0) {
+                    out_edges[cell].pop_back();
+                }
+                if (out_edges[cell].empty()) {
+                    break;
+                }
+                int g = out_edges[cell].back();
+                walked.emplace_back(g);
+                amount = std::min(amount, remaining_flow[g]);
+                cell = flow.EdgeTo(grid_edges[g]);
+            }
+            if (walked.empty() || deficit[cell] == 0) {
+                break;
+            }
+            amount = std::min(amount, deficit[cell]);
+            for (int g : walked) {
+                remaining_flow[g] -= amount;
+            }
+            deficit[cell] -= amount;
+            surplus -= amount;
+            for (int m = 0; m < amount; ++m) {
+                moves.emplace_back(idle_in_cell[c].back(), forecast.CellCenter(cell));
+                idle_in_cell[c].pop_back();
+            }
+        }
+    }
+    return moves;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,68 @@
+/**
+ * @file rebalancer.h
+ * @brief Periodically sends idle vehicles toward cells where demand is forecast to outstrip them.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef REBALANCER_H_
+#define REBALANCER_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+#include "concurrent/concurrent_object.h"
+#include "concurrent/vehicle_manager.h"
+#include "dispatch/demand_forecast.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+#include "metrics/metrics.h"
+
+namespace rideshare {
+
+class Rebalancer : public ConcurrentObject {
+  public:
+    // Constructor / Destructor
+    // Rebalance every `interval_ms`, from published snapshots of passengers and vehicles
+    Rebalancer(const Model &model, std::shared_ptr<VehicleManager> vehicle_manager,
+               SnapshotBuffer *passenger_snapshots, SnapshotBuffer *vehicle_snapshots, int interval_ms);
+
+    // Setters
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+
+    // Concurrent simulation
+    void Simulate();
+
+    // Plan moves of idle vehicles, given as (id, position) pairs, so idle vehicles in each cell match that cell's
+    //  share of forecast demand, at the least total grid distance driven. Returns (vehicle id, target) pairs
+    static std::vector<std::pair<int, Coordinate>> PlanMoves(const DemandForecast &forecast,
+                                                             const std::vector<std::pair<int, Coordinate>> &idle);
+
+  private:
+    // Handles loop cycle of counting new requests and rebalancing each interval
+    void Rebalance();
+    // Count any passengers requesting rides since the last snapshot read
+    void CountRequests();
+    // Send idle vehicles from the latest vehicle snapshot toward forecast demand
+    void MoveIdleVehicles();
+
+    // Member variables
+    std::shared_ptr<VehicleManager> vehicle_manager_;
+    SnapshotBuffer *passenger_snapshots_;
+    SnapshotBuffer *vehicle_snapshots_;
+    AgentSnapshot passengers_;
+    AgentSnapshot vehicles_;
+    DemandForecast forecast_;
+    int last_request_id_ = -1; // passenger ids only increase, so any higher are new requests
+    std::shared_ptr<Metrics> metrics_;
+    const int INTERVAL_; // ms between each rebalance
+    static const int GRID_CELLS_PER_SIDE_ = 16;
+    static constexpr double SMOOTHING_ = 0.3; // weight of the latest interval in the forecast
+};
+
+}  // namespace rideshare
+
+#endif  // REBALANCER_H_
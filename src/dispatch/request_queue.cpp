@@ -0,0 +1,109 @@
+/**
+ * @file request_queue.cpp
+ * @brief Implementation of the indexed binary heap of waiting ride requests.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "request_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+
+namespace rideshare {
+
+std::vector<int> RequestQueue::Ids() const {
+    std::vector<int> ids;
+    ids.reserve(heap_.size());
+    for (const Entry &entry : heap_) {
+        ids.emplace_back(entry.id);
+    }
+    return ids;
+}
+
+std::vector<int> RequestQueue::First(size_t count) const {
+    std::vector<Entry> entries(heap_);
+    count = std::min(count, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + count, entries.end());
+    std::vector<int> ids;
+    for (size_t i = 0; i < count; ++i) {
+        ids.emplace_back(entries[i].id);
+    }
+    return ids;
+}
+
+void RequestQueue::Push(int id, std::chrono::steady_clock::time_point key) {
+    auto found = positions_.find(id);
+    if (found == positions_.end()) {
+        heap_.push_back({ .key = key, .id = id });
+        positions_.emplace(id, heap_.size() - 1);
+        SiftUp(heap_.size() - 1);
+        return;
+    }
+    // Moving a request only ever needs to go one way, depending on whether it's now earlier or later
+    size_t position = found->second;
+    bool earlier = key < heap_[position].key;
+    heap_[position].key = key;
+    if (earlier) {
+        SiftUp(position);
+    } else {
+        SiftDown(position);
+    }
+}
+
+void RequestQueue::Erase(int id) {
+    auto found = positions_.find(id);
+    if (found == positions_.end()) {
+        return;
+    }
+    // Fill the gap with the last entry, which may then belong either above or below it
+    size_t position = found->second;
+    size_t last = heap_.size() - 1;
+    if (position != last) {
+        Swap(position, last);
+    }
+    heap_.pop_back();
+    positions_.erase(id);
+    if (position < heap_.size()) {
+        SiftUp(position);
+        SiftDown(position);
+    }
+}
+
+void RequestQueue::SiftUp(size_t position) {
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!(heap_[position] < heap_[parent])) {
+            break;
+        }
+        Swap(position, parent);
+        position = parent;
+    }
+}
+
+void RequestQueue::SiftDown(size_t position) {
+    while (true) {
+        size_t first = position;
+        for (size_t child = (2 * position) + 1; child <= (2 * position) + 2 && child < heap_.size(); ++child) {
+            if (heap_[child] < heap_[first]) {
+                first = child;
+            }
+        }
+        if (first == position) {
+            break;
+        }
+        Swap(position, first);
+        position = first;
+    }
+}
+
+void RequestQueue::Swap(size_t a, size_t b) {
+    std::swap(heap_[a], heap_[b]);
+    positions_[heap_[a].id] = a;
+    positions_[heap_[b].id] = b;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,60 @@
+/**
+ * @file request_queue.h
+ * @brief Indexed binary heap of waiting ride requests, served in order of when each counts as requested.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef REQUEST_QUEUE_H_
+#define REQUEST_QUEUE_H_
+
+#include <chrono>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace rideshare {
+
+// Each request is keyed by the time it counts as made, so the longest waiting (plus any head start or
+//  penalty folded into the key) is served first. Keeps each id's place in the heap, so moving or removing
+//  any request is O(log n). Not thread-safe; meant to be owned by a single ride matcher.
+class RequestQueue {
+  public:
+    // Getters
+    bool Contains(int id) const { return positions_.count(id) == 1; }
+    bool Empty() const { return heap_.empty(); }
+    size_t Size() const { return heap_.size(); }
+    // Request to serve first (earliest key, then lowest id); the queue must not be empty
+    int Top() const { return heap_.front().id; }
+    std::chrono::steady_clock::time_point Key(int id) const { return heap_[positions_.at(id)].key; }
+    // Ids in heap order, which is only sorted as far as the first being first
+    std::vector<int> Ids() const;
+    // Ids of up to `count` requests to serve first, in order
+    std::vector<int> First(size_t count) const;
+
+    // Add a request, or move one already queued to a new key
+    void Push(int id, std::chrono::steady_clock::time_point key);
+    // Remove a request, if queued
+    void Erase(int id);
+
+  private:
+    struct Entry {
+        std::chrono::steady_clock::time_point key;
+        int id;
+        bool operator<(const Entry &other) const { return key < other.key || (key == other.key && id < other.id); }
+    };
+    // Restore heap order around an entry moved to a position
+    void SiftUp(size_t position);
+    void SiftDown(size_t position);
+    // Swap two entries, keeping positions_ up to date
+    void Swap(size_t a, size_t b);
+
+    // Member variables
+    std::vector<Entry> heap_;
+    std::unordered_map<int, size_t> positions_; // id, index into heap_
+};
+
+}  // namespace rideshare
+
+#endif  // REQUEST_QUEUE_H_
@@ -0,0 +1,245 @@
+/**
+ * @file delta_codec.cpp
+ * @brief Implementation of encoding and decoding keyframes and delta frames of agent state.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "delta_codec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+
+namespace rideshare {
+
+namespace delta_codec {
+
+enum RecordOp : uint8_t {
+    set_op,
+    move_op,
+    remove_op,
+};
+
+static bool KeyLess(const ExportAgent &agent1, const ExportAgent &agent2) {
+    return (agent1.id < agent2.id) || (agent1.id == agent2.id && agent1.kind < agent2.kind);
+}
+
+// Writing
+
+static void PutFixed(std::vector<uint8_t> &frame, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        frame.push_back((uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void PutVarint(std::vector<uint8_t> &frame, uint64_t value) {
+    while (value >= 0x80) {
+        frame.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    frame.push_back((uint8_t)value);
+}
+
+// Zigzag keeps small negative values small: 0, -1, 1, -2, ... become 0, 1, 2, 3, ...
+static void PutZigzag(std::vector<uint8_t> &frame, int64_t value) {
+    PutVarint(frame, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void PutHeader(std::vector<uint8_t> &frame, FrameType type, uint64_t sequence) {
+    frame.clear();
+    PutFixed(frame, MAGIC, 4);
+    PutFixed(frame, type, 4); // type, then reserved bytes
+    PutFixed(frame, sequence, 8);
+    PutFixed(frame, 0, 4);    // record count, filled in once known
+}
+
+static void SetRecordCount(std::vector<uint8_t> &frame, uint32_t records) {
+    for (int i = 0; i < 4; ++i) {
+        frame[HEADER_SIZE - 4 + i] = (uint8_t)(records >> (8 * i));
+    }
+}
+
+static void PutKey(std::vector<uint8_t> &frame, int32_t &last_id, const ExportAgent &agent, RecordOp op) {
+    PutVarint(frame, (uint32_t)(agent.id - last_id));
+    last_id = agent.id;
+    frame.push_back((uint8_t)((op << 4) | agent.kind));
+}
+
+void AppendAgents(const std::vector<AgentState> &states, std::vector<ExportAgent> &agents) {
+    for (const AgentState &state : states) {
+        agents.push_back({ .id = state.id, .kind = state.kind, .state = state.state,
+                           .x = (int32_t)std::lround(state.position.x * UNITS_PER_DEGREE),
+                           .y = (int32_t)std::lround(state.position.y * UNITS_PER_DEGREE) });
+    }
+}
+
+void SortAgents(std::vector<ExportAgent> &agents) {
+    std::sort(agents.begin(), agents.end(), KeyLess);
+}
+
+void EncodeKeyframe(uint64_t sequence, const std::vector<ExportAgent> &agents, std::vector<uint8_t> &frame) {
+    PutHeader(frame, FrameType::keyframe, sequence);
+    int32_t last_id = 0;
+    for (const ExportAgent &agent : agents) {
+        PutKey(frame, last_id, agent, RecordOp::set_op);
+        frame.push_back(agent.state);
+        PutZigzag(frame, agent.x);
+        PutZigzag(frame, agent.y);
+    }
+    SetRecordCount(frame, (uint32_t)agents.size());
+}
+
+void EncodeDelta(uint64_t sequence, const std::vector<ExportAgent> &previous,
+                 const std::vector<ExportAgent> &current, std::vector<uint8_t> &frame) {
+    PutHeader(frame, FrameType::delta, sequence);
+    int32_t last_id = 0;
+    uint32_t records = 0;
+    // Both lists are sorted, so a single merge pass finds added, changed and removed agents
+    auto prev = previous.begin();
+    auto curr = current.begin();
+    while (prev != previous.end() || curr != current.end()) {
+        if (curr == current.end() || (prev != previous.end() && KeyLess(*prev, *curr))) {
+            PutKey(frame, last_id, *prev, RecordOp::remove_op);
+            ++records;
+            ++prev;
+        } else if (prev == previous.end() || KeyLess(*curr, *prev)) {
+            PutKey(frame, last_id, *curr, RecordOp::set_op);
+            frame.push_back(curr->state);
+            PutZigzag(frame, curr->x);
+            PutZigzag(frame, curr->y);
+            ++records;
+            ++curr;
+        } else {
+            if (curr->state != prev->state || curr->x != prev->x || curr->y != prev->y) {
+                PutKey(frame, last_id, *curr, RecordOp::move_op);
+                frame.push_back(curr->state);
+                PutZigzag(frame, (int64_t)curr->x - prev->x);
+                PutZigzag(frame, (int64_t)curr->y - prev->y);
+                ++records;
+            }
+            ++prev;
+            ++curr;
+        }
+    }
+    SetRecordCount(frame, records);
+}
+
+// Reading
+
+// Reads from a frame, failing (rather than reading past the end) on truncated data
+class Reader {
+  public:
+    Reader(const uint8_t *data, size_t size) : data_(data), end_(data + size) {}
+
+    bool Fixed(uint64_t &value, int bytes) {
+        if (end_ - data_ < bytes) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= (uint64_t)(*data_++) << (8 * i);
+        }
+        return true;
+    }
+
+    bool Varint(uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && data_ < end_; shift += 7) {
+            uint8_t byte = *data_++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool Zigzag(int64_t &value) {
+        uint64_t encoded;
+        if (!Varint(encoded)) {
+            return false;
+        }
+        value = (int64_t)(encoded >> 1) ^ -(int64_t)(encoded & 1);
+        return true;
+    }
+
+  private:
+    const uint8_t *data_;
+    const uint8_t *end_;
+};
+
+bool DecodeFrame(const uint8_t *data, size_t size, std::vector<ExportAgent> &agents, uint64_t &sequence) {
+    Reader reader(data, size);
+    uint64_t magic, type, frame_sequence, records;
+    if (!reader.Fixed(magic, 4) || magic != MAGIC || !reader.Fixed(type, 4) ||
+        !reader.Fixed(frame_sequence, 8) || !reader.Fixed(records, 4)) {
+        return false;
+    }
+    type &= 0xff; // ignore reserved bytes
+    if (type != FrameType::keyframe && (type != FrameType::delta || frame_sequence != sequence + 1)) {
+        return false;
+    }
+
+    // Merge records into the agents so far, which are in the same order
+    std::vector<ExportAgent> next;
+    next.reserve(agents.size() + std::min<uint64_t>(records, size)); // every record takes at least a byte
+    auto prev = agents.begin();
+    auto prev_end = (type == FrameType::keyframe) ? agents.begin() : agents.end();
+    int32_t last_id = 0;
+    for (uint64_t r = 0; r < records; ++r) {
+        uint64_t id_delta, op_kind;
+        if (!reader.Varint(id_delta) || !reader.Fixed(op_kind, 1)) {
+            return false;
+        }
+        ExportAgent agent = { .id = last_id + (int32_t)id_delta, .kind = (uint8_t)(op_kind & 0x0f),
+                              .state = 0, .x = 0, .y = 0 };
+        last_id = agent.id;
+        // Agents without a record are unchanged
+        while (prev != prev_end && KeyLess(*prev, agent)) {
+            next.push_back(*prev++);
+        }
+        bool existing = (prev != prev_end && !KeyLess(agent, *prev));
+        RecordOp op = (RecordOp)(op_kind >> 4);
+        if (op == RecordOp::remove_op) {
+            if (existing) {
+                ++prev;
+            }
+            continue;
+        }
+        uint64_t state;
+        int64_t x, y;
+        if (!reader.Fixed(state, 1) || !reader.Zigzag(x) || !reader.Zigzag(y)) {
+            return false;
+        }
+        agent.state = (uint8_t)state;
+        if (op == RecordOp::move_op) {
+            if (!existing) {
+                return false;
+            }
+            x += prev->x;
+            y += prev->y;
+        }
+        agent.x = (int32_t)x;
+        agent.y = (int32_t)y;
+        next.push_back(agent);
+        if (existing) {
+            ++prev;
+        }
+    }
+    next.insert(next.end(), prev, prev_end);
+
+    std::swap(agents, next);
+    sequence = frame_sequence;
+    return true;
+}
+
+}  // namespace delta_codec
+
+}  // namespace rideshare
@@ -0,0 +1,77 @@
+/**
+ * @file delta_codec.h
+ * @brief Compact binary frames of per-tick agent state, as full keyframes or deltas from the previous frame.
+ *
+ * Frame layout (all fixed-size fields little-endian):
+ *   uint32 magic      'R','S','F','1'
+ *   uint8  type       0 = keyframe, 1 = delta from the frame with sequence - 1
+ *   uint8  reserved[3]
+ *   uint64 sequence   increases by one with each frame encoded
+ *   uint32 records    count of agent records that follow
+ * Records are sorted by (id, kind), and each starts with:
+ *   varint id_delta   id minus the previous record's id (the first is from 0)
+ *   uint8  op_kind    (op << 4) | AgentKind, where op is 0 = set, 1 = move, 2 = remove
+ * followed by, for each op:
+ *   set:    uint8 state, zigzag varint x, zigzag varint y  (absolute position)
+ *   move:   uint8 state, zigzag varint dx, zigzag varint dy (change since the previous frame)
+ *   remove: nothing
+ * Positions are longitude (x) and latitude (y) in fixed point units of 1e-7 degrees.
+ * A keyframe holds only set records, for every agent. A delta holds records only for agents
+ *  added, changed or removed since the previous frame, so a viewer must apply every delta in order.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef DELTA_CODEC_H_
+#define DELTA_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+
+namespace rideshare {
+
+// Exported state of a single agent
+struct ExportAgent {
+    int32_t id;
+    uint8_t kind;  // AgentKind
+    uint8_t state; // VehicleState or Passenger::PassengerStatus
+    int32_t x;     // longitude, in 1e-7 degrees
+    int32_t y;     // latitude, in 1e-7 degrees
+};
+
+namespace delta_codec {
+
+enum FrameType : uint8_t {
+    keyframe,
+    delta,
+};
+
+const uint32_t MAGIC = 0x31465352; // "RSF1" in little-endian byte order
+const size_t HEADER_SIZE = 20;
+const double UNITS_PER_DEGREE = 1e7;
+
+// Convert snapshot agents to exported agents, appending to `agents`. Call SortAgents once all are added
+void AppendAgents(const std::vector<AgentState> &states, std::vector<ExportAgent> &agents);
+// Sort into (id, kind) order, as both encoding and decoding expect
+void SortAgents(std::vector<ExportAgent> &agents);
+
+// Encode all agents as a keyframe, replacing the contents of `frame`
+void EncodeKeyframe(uint64_t sequence, const std::vector<ExportAgent> &agents, std::vector<uint8_t> &frame);
+// Encode only what changed between two sorted agent lists, replacing the contents of `frame`
+void EncodeDelta(uint64_t sequence, const std::vector<ExportAgent> &previous,
+                 const std::vector<ExportAgent> &current, std::vector<uint8_t> &frame);
+
+// Apply a frame onto the agents decoded so far (sorted, empty to start). A keyframe replaces them.
+//  Returns false if the frame is malformed, or a delta that doesn't follow `sequence`; `sequence` is
+//  updated to the frame's on success
+bool DecodeFrame(const uint8_t *data, size_t size, std::vector<ExportAgent> &agents, uint64_t &sequence);
+
+}  // namespace delta_codec
+
+}  // namespace rideshare
+
+#endif  // DELTA_CODEC_H_
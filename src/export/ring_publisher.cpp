@@ -0,0 +1,61 @@
+/**
+ * @file ring_publisher.cpp
+ * @brief Implementation of merging published snapshots into shared memory ring frames.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "ring_publisher.h"
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "export/delta_codec.h"
+#include "export/snapshot_ring.h"
+
+namespace rideshare {
+
+void RingPublisher::Simulate() {
+    // Launch Publish function in a thread
+    threads.emplace_back(std::thread(&RingPublisher::Publish, this));
+}
+
+void RingPublisher::Publish() {
+    SnapshotRing ring = SnapshotRing::Create(NAME_, SLOT_COUNT_, SLOT_CAPACITY_);
+    if (!ring.Valid()) {
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << ring.Error() << std::endl;
+        return;
+    }
+    int64_t tick = 0;
+    while (true) {
+        // sleep at every iteration to reduce CPU usage
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        bool updated = false;
+        for (SnapshotSource &source : sources_) {
+            updated |= source.snapshots->Read(source.latest);
+        }
+        if (!updated) {
+            continue;
+        }
+
+        // Merge every source into one frame, sorted by (id, kind) as in the exported stream
+        agents_.clear();
+        for (const SnapshotSource &source : sources_) {
+            delta_codec::AppendAgents(source.latest.agents, agents_);
+        }
+        delta_codec::SortAgents(agents_);
+        auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+        ring.Write(++tick, std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count(), agents_);
+
+        if (metrics_ != nullptr && agents_.size() > SLOT_CAPACITY_) {
+            metrics_->Increment("ring_agents_truncated", agents_.size() - SLOT_CAPACITY_);
+        }
+    }
+}
+
+}  // namespace rideshare
@@ -0,0 +1,61 @@
+/**
+ * @file ring_publisher.h
+ * @brief Write each published tick of agent state into a shared memory ring for in-box consumers.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef RING_PUBLISHER_H_
+#define RING_PUBLISHER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+#include "concurrent/concurrent_object.h"
+#include "export/delta_codec.h"
+#include "export/snapshot_ring.h"
+#include "metrics/metrics.h"
+
+namespace rideshare {
+
+class RingPublisher : public ConcurrentObject {
+  public:
+    // Constructor / Destructor
+    // Ring `name` (e.g. "/rideshare") of `slot_count` frames, each with room for `slot_capacity` agents
+    RingPublisher(std::string name, uint32_t slot_count, uint32_t slot_capacity) :
+                  NAME_(name), SLOT_COUNT_(slot_count), SLOT_CAPACITY_(slot_capacity) {};
+
+    // Setters
+    // Add published snapshots to write out (e.g. the vehicle manager's); live objects are never read
+    void AddSnapshotSource(SnapshotBuffer *snapshots) { sources_.emplace_back(); sources_.back().snapshots = snapshots; }
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+
+    // Concurrent simulation
+    void Simulate();
+
+  private:
+    // Latest snapshot read from a single publisher
+    struct SnapshotSource {
+        SnapshotBuffer *snapshots;
+        AgentSnapshot latest;
+    };
+
+    // Handles loop cycle of writing a frame to the ring for each new tick
+    void Publish();
+
+    // Member variables
+    const std::string NAME_;
+    const uint32_t SLOT_COUNT_;
+    const uint32_t SLOT_CAPACITY_;
+    std::vector<SnapshotSource> sources_;
+    std::vector<ExportAgent> agents_; // all sources merged, re-used each tick
+    std::shared_ptr<Metrics> metrics_;
+};
+
+}  // namespace rideshare
+
+#endif  // RING_PUBLISHER_H_
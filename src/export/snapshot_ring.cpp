@@ -0,0 +1,187 @@
+/**
+ * @file snapshot_ring.cpp
+ * @brief Implementation of the shared memory snapshot ring, with per-slot seqlocks for overrun detection.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "snapshot_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "export/delta_codec.h"
+
+namespace rideshare {
+
+// Shared between processes, so the layout must be plain data and the atomics must not need a lock
+static_assert(std::is_trivially_copyable<ExportAgent>::value && sizeof(ExportAgent) == 16,
+              "ExportAgent is part of the shared memory layout");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory sequences must be lock-free");
+
+SnapshotRing SnapshotRing::Failed(const std::string &what, const std::string &name) {
+    SnapshotRing ring(name, false, nullptr, 0);
+    ring.error_ = what + " " + name + ": " + std::strerror(errno);
+    return ring;
+}
+
+SnapshotRing SnapshotRing::Create(const std::string &name, uint32_t slot_count, uint32_t slot_capacity) {
+    uint64_t slot_bytes = sizeof(SlotHeader) + ((uint64_t)slot_capacity * sizeof(ExportAgent));
+    size_t size = sizeof(RingHeader) + (slot_count * slot_bytes);
+
+    // Start fresh, in case an earlier run left a ring of another size behind
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        return Failed("Unable to create shared memory", name);
+    }
+    void *memory = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return Failed("Unable to map shared memory", name);
+    }
+
+    // New shared memory is zeroed, so every slot starts out as never written (sequence 0).
+    //  The magic goes last, so a consumer opening too early sees the ring as not ready yet
+    RingHeader *header = new (memory) RingHeader;
+    header->slot_count = slot_count;
+    header->slot_capacity = slot_capacity;
+    header->agent_size = sizeof(ExportAgent);
+    header->slot_bytes = slot_bytes;
+    header->last_sequence.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        char *slot = (char *)memory + sizeof(RingHeader) + (i * slot_bytes);
+        new (slot) SlotHeader;
+        ((SlotHeader *)slot)->sequence.store(0, std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MAGIC_;
+    return SnapshotRing(name, true, memory, size);
+}
+
+SnapshotRing SnapshotRing::Open(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return Failed("Unable to open shared memory", name);
+    }
+    struct stat info;
+    void *memory = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(RingHeader)) {
+        memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (memory == MAP_FAILED) {
+        return Failed("Unable to map shared memory", name);
+    }
+
+    // Only use a ring laid out the way this build expects, and that fits what was mapped
+    const RingHeader *header = (const RingHeader *)memory;
+    uint32_t magic = header->magic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (magic != MAGIC_ || header->agent_size != sizeof(ExportAgent) ||
+        sizeof(RingHeader) + (header->slot_count * header->slot_bytes) > (size_t)info.st_size) {
+        munmap(memory, info.st_size);
+        errno = EINVAL;
+        return Failed("Incompatible shared memory ring", name);
+    }
+    return SnapshotRing(name, false, memory, info.st_size);
+}
+
+SnapshotRing::SnapshotRing(const std::string &name, bool owner, void *memory, size_t size) :
+                           name_(name), owner_(owner), memory_(memory), size_(size),
+                           header_((RingHeader *)memory) {}
+
+SnapshotRing::SnapshotRing(SnapshotRing &&other) noexcept :
+                           name_(std::move(other.name_)), error_(std::move(other.error_)), owner_(other.owner_),
+                           memory_(other.memory_), size_(other.size_), header_(other.header_) {
+    other.owner_ = false;
+    other.memory_ = nullptr;
+    other.header_ = nullptr;
+}
+
+SnapshotRing::~SnapshotRing() {
+    if (memory_ != nullptr) {
+        munmap(memory_, size_);
+    }
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+uint64_t SnapshotRing::LatestSequence() const {
+    return header_->last_sequence.load(std::memory_order_acquire);
+}
+
+uint64_t SnapshotRing::OldestSequence() const {
+    uint64_t latest = LatestSequence();
+    // The slot after the latest may be mid-write, so don't count it as readable
+    return (latest >= header_->slot_count) ? latest - header_->slot_count + 2 : 1;
+}
+
+SnapshotRing::SlotHeader *SnapshotRing::Slot(uint64_t sequence) const {
+    char *slots = (char *)memory_ + sizeof(RingHeader);
+    return (SlotHeader *)(slots + ((sequence % header_->slot_count) * header_->slot_bytes));
+}
+
+void SnapshotRing::Write(int64_t tick, int64_t time_ns, const std::vector<ExportAgent> &agents) {
+    uint64_t sequence = header_->last_sequence.load(std::memory_order_relaxed) + 1;
+    SlotHeader *slot = Slot(sequence);
+
+    // Mark as being written before touching anything else in the slot
+    slot->sequence.store((2 * sequence) - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t count = std::min<uint64_t>(agents.size(), header_->slot_capacity);
+    slot->tick = tick;
+    slot->time_ns = time_ns;
+    slot->agent_count = count;
+    slot->truncated = (count < agents.size()) ? 1 : 0;
+    std::memcpy((ExportAgent *)(slot + 1), agents.data(), count * sizeof(ExportAgent));
+
+    // Complete, then publish as the latest
+    slot->sequence.store(2 * sequence, std::memory_order_release);
+    header_->last_sequence.store(sequence, std::memory_order_release);
+}
+
+SnapshotRing::ReadStatus SnapshotRing::BeginRead(uint64_t sequence, FrameView &view) const {
+    if (sequence > LatestSequence()) {
+        return ReadStatus::not_yet;
+    }
+    const SlotHeader *slot = Slot(sequence);
+    uint64_t slot_sequence = slot->sequence.load(std::memory_order_acquire);
+    if (slot_sequence != 2 * sequence) {
+        // Being (or already) re-written with a later frame
+        return ReadStatus::overrun;
+    }
+    view.sequence = sequence;
+    view.tick = slot->tick;
+    view.time_ns = slot->time_ns;
+    view.truncated = slot->truncated != 0;
+    view.agents = (const ExportAgent *)(slot + 1);
+    view.agent_count = std::min(slot->agent_count, header_->slot_capacity);
+    return ReadStatus::ready;
+}
+
+bool SnapshotRing::EndRead(const FrameView &view) const {
+    // Order all reads of the frame before re-checking that the producer hasn't started on the slot
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return Slot(view.sequence)->sequence.load(std::memory_order_relaxed) == 2 * view.sequence;
+}
+
+}  // namespace rideshare
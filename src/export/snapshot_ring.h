@@ -0,0 +1,114 @@
+/**
+ * @file snapshot_ring.h
+ * @brief Single-producer, multi-consumer ring of fixed-layout agent snapshot frames in POSIX shared memory.
+ *
+ * Shared memory layout (native byte order, as producer and consumers share a machine):
+ *   RingHeader                     magic, layout sizes, and the sequence of the last frame written
+ *   slot_count x [SlotHeader, ExportAgent x slot_capacity]
+ * Frame `sequence` (starting at 1) is written to slot `sequence % slot_count`. Each slot's sequence
+ *  works as a seqlock: it is odd while the frame is being written, and 2 * sequence once complete.
+ *  Consumers read frames in place, then check the slot wasn't re-written underneath them, so slow
+ *  consumers see an overrun rather than a torn frame, and the producer never waits on anyone.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef SNAPSHOT_RING_H_
+#define SNAPSHOT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "export/delta_codec.h"
+
+namespace rideshare {
+
+class SnapshotRing {
+  public:
+    // Result of trying to read a given frame sequence
+    enum ReadStatus {
+        ready,    // frame is available to read in place
+        not_yet,  // frame hasn't been written yet
+        overrun,  // frame was already overwritten; skip ahead to OldestSequence()
+    };
+
+    // A frame being read in place, only valid if EndRead returns true afterward
+    struct FrameView {
+        uint64_t sequence;
+        int64_t tick;
+        int64_t time_ns;       // steady clock time the frame was written, in ns
+        bool truncated;        // more agents than the slot capacity, so some were left out
+        const ExportAgent *agents;
+        uint32_t agent_count;
+    };
+
+    // Constructor / Destructor
+    // Create (or re-create) the named ring for writing, with room for `slot_capacity` agents per frame
+    static SnapshotRing Create(const std::string &name, uint32_t slot_count, uint32_t slot_capacity);
+    // Open an existing named ring for reading
+    static SnapshotRing Open(const std::string &name);
+    SnapshotRing(SnapshotRing &&other) noexcept;
+    SnapshotRing(const SnapshotRing &) = delete;
+    SnapshotRing &operator=(const SnapshotRing &) = delete;
+    ~SnapshotRing();
+
+    // Getters
+    // Whether the shared memory was created or opened successfully
+    bool Valid() const { return header_ != nullptr; }
+    // Why the shared memory couldn't be created or opened, if not valid
+    const std::string &Error() const { return error_; }
+    // Sequence of the last complete frame, 0 if none yet
+    uint64_t LatestSequence() const;
+    // Oldest sequence that could still be read, given the ring's size
+    uint64_t OldestSequence() const;
+
+    // Producer
+    // Write the next frame from sorted agents, overwriting the oldest slot
+    void Write(int64_t tick, int64_t time_ns, const std::vector<ExportAgent> &agents);
+
+    // Consumers
+    // Start reading the frame with the given sequence in place
+    ReadStatus BeginRead(uint64_t sequence, FrameView &view) const;
+    // Whether the frame was left untouched while being read, so what was read from it can be used
+    bool EndRead(const FrameView &view) const;
+
+  private:
+    struct RingHeader {
+        uint32_t magic;
+        uint32_t slot_count;
+        uint32_t slot_capacity;
+        uint32_t agent_size;
+        uint64_t slot_bytes;
+        std::atomic<uint64_t> last_sequence;
+    };
+    struct SlotHeader {
+        std::atomic<uint64_t> sequence; // odd while writing, 2 * frame sequence once complete
+        int64_t tick;
+        int64_t time_ns;
+        uint32_t agent_count;
+        uint32_t truncated;
+    };
+
+    SnapshotRing(const std::string &name, bool owner, void *memory, size_t size);
+    // Invalid ring, with an error describing why a system call failed
+    static SnapshotRing Failed(const std::string &what, const std::string &name);
+    // Header of the slot a given frame sequence is written to
+    SlotHeader *Slot(uint64_t sequence) const;
+
+    // Member variables
+    std::string name_;
+    std::string error_;
+    bool owner_;     // created by this process, so unlinked when done
+    void *memory_;
+    size_t size_;
+    RingHeader *header_;
+    static const uint32_t MAGIC_ = 0x474e4952; // "RING" in little-endian byte order
+};
+
+}  // namespace rideshare
+
+#endif  // SNAPSHOT_RING_H_
@@ -0,0 +1,162 @@
+/**
+ * @file snapshot_streamer.cpp
+ * @brief Implementation of the non-blocking viewer socket and per-tick frame streaming.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "snapshot_streamer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "export/delta_codec.h"
+
+namespace rideshare {
+
+void SnapshotStreamer::Simulate() {
+    // Launch Stream function in a thread
+    threads.emplace_back(std::thread(&SnapshotStreamer::Stream, this));
+}
+
+void SnapshotStreamer::Stream() {
+    if (!OpenSocket()) {
+        return;
+    }
+    while (true) {
+        // sleep at every iteration to reduce CPU usage
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        AcceptViewers();
+        if (!GatherAgents()) {
+            continue;
+        }
+        // Only encode when someone is watching, but keep previous_ current either way
+        if (!viewers_.empty()) {
+            SendFrames();
+        }
+        std::swap(previous_, current_);
+        ++sequence_;
+    }
+}
+
+bool SnapshotStreamer::OpenSocket() {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (SOCKET_PATH_.size() >= sizeof(address.sun_path)) {
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << "Export socket path is too long: " << SOCKET_PATH_ << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, SOCKET_PATH_.c_str(), sizeof(address.sun_path) - 1);
+
+    // Remove a socket file left behind by an earlier run
+    unlink(SOCKET_PATH_.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0 || bind(listen_fd_, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(listen_fd_, MAX_VIEWERS_) != 0) {
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << "Unable to open export socket " << SOCKET_PATH_ << ": " << std::strerror(errno) << std::endl;
+        if (listen_fd_ >= 0) {
+            close(listen_fd_);
+            listen_fd_ = -1;
+        }
+        return false;
+    }
+    return true;
+}
+
+void SnapshotStreamer::AcceptViewers() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // none waiting (EAGAIN), or nothing to do about a failed connection
+        }
+        if ((int)viewers_.size() >= MAX_VIEWERS_) {
+            close(fd);
+            continue;
+        }
+        // Large enough for a whole keyframe, as each frame is sent as a single message
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_BYTES_, sizeof(SEND_BUFFER_BYTES_));
+        viewers_.push_back({ .fd = fd, .needs_keyframe = true });
+        if (metrics_ != nullptr) {
+            metrics_->Increment("export_viewers");
+        }
+    }
+}
+
+bool SnapshotStreamer::GatherAgents() {
+    bool updated = false;
+    for (SnapshotSource &source : sources_) {
+        updated |= source.snapshots->Read(source.latest);
+    }
+    if (!updated) {
+        return false;
+    }
+    // Merge every source into one list, sorted by (id, kind) for delta encoding
+    current_.clear();
+    for (const SnapshotSource &source : sources_) {
+        delta_codec::AppendAgents(source.latest.agents, current_);
+    }
+    delta_codec::SortAgents(current_);
+    return true;
+}
+
+void SnapshotStreamer::SendFrames() {
+    // Each frame is encoded at most once, however many viewers there are
+    bool delta_encoded = false;
+    bool keyframe_encoded = false;
+    long dropped = 0;
+    for (auto viewer = viewers_.begin(); viewer != viewers_.end();) {
+        const std::vector<uint8_t> *frame;
+        if (viewer->needs_keyframe) {
+            if (!keyframe_encoded) {
+                delta_codec::EncodeKeyframe(sequence_, current_, keyframe_);
+                keyframe_encoded = true;
+            }
+            frame = &keyframe_;
+        } else {
+            if (!delta_encoded) {
+                delta_codec::EncodeDelta(sequence_, previous_, current_, delta_frame_);
+                delta_encoded = true;
+            }
+            frame = &delta_frame_;
+        }
+
+        // Never wait on a viewer: a full socket just means it misses this frame
+        ssize_t sent = send(viewer->fd, frame->data(), frame->size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent == (ssize_t)frame->size()) {
+            viewer->needs_keyframe = false;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            viewer->needs_keyframe = true;
+            ++dropped;
+        } else {
+            // Disconnected, or the frame can never fit, so stop streaming to this viewer
+            close(viewer->fd);
+            viewer = viewers_.erase(viewer);
+            continue;
+        }
+        ++viewer;
+    }
+
+    if (metrics_ != nullptr) {
+        metrics_->Record("export_bytes", delta_encoded ? delta_frame_.size() : keyframe_.size());
+        if (dropped > 0) {
+            metrics_->Increment("export_frames_dropped", dropped);
+        }
+    }
+}
+
+}  // namespace rideshare
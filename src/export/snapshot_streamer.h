@@ -0,0 +1,82 @@
+/**
+ * @file snapshot_streamer.h
+ * @brief Stream published agent snapshots to external viewer processes over a Unix domain socket.
+ *
+ * Viewers connect to a SOCK_SEQPACKET socket at the given path, and receive one message per
+ *  simulation tick, each a single frame as described in delta_codec.h. The first frame a viewer
+ *  receives is a keyframe; after that, deltas follow for as long as it keeps up.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef SNAPSHOT_STREAMER_H_
+#define SNAPSHOT_STREAMER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "concurrent/agent_snapshot.h"
+#include "concurrent/concurrent_object.h"
+#include "export/delta_codec.h"
+#include "metrics/metrics.h"
+
+namespace rideshare {
+
+class SnapshotStreamer : public ConcurrentObject {
+  public:
+    // Constructor / Destructor
+    SnapshotStreamer(std::string socket_path) : SOCKET_PATH_(socket_path) {};
+
+    // Setters
+    // Add published snapshots to stream (e.g. the vehicle manager's); like graphics, live objects are never read
+    void AddSnapshotSource(SnapshotBuffer *snapshots) { sources_.emplace_back(); sources_.back().snapshots = snapshots; }
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+
+    // Concurrent simulation
+    void Simulate();
+
+  private:
+    // Latest snapshot read from a single publisher
+    struct SnapshotSource {
+        SnapshotBuffer *snapshots;
+        AgentSnapshot latest;
+    };
+    // A connected viewer, which needs a keyframe when new or after missing a frame
+    struct Viewer {
+        int fd;
+        bool needs_keyframe;
+    };
+
+    // Handles loop cycle of accepting viewers and sending each new tick
+    void Stream();
+    // Create the non-blocking listening socket, returning whether successful
+    bool OpenSocket();
+    // Accept any viewers waiting to connect, without blocking
+    void AcceptViewers();
+    // Read any newly published snapshots into current_, returning whether any were new
+    bool GatherAgents();
+    // Send the frame to each viewer, or a keyframe to those who need one. A viewer whose
+    //  socket is full misses the frame (rather than waiting on it), and resyncs on a later keyframe
+    void SendFrames();
+
+    // Member variables
+    const std::string SOCKET_PATH_;
+    int listen_fd_ = -1;
+    std::vector<Viewer> viewers_;
+    std::vector<SnapshotSource> sources_;
+    std::vector<ExportAgent> previous_; // agents as of the last frame sent
+    std::vector<ExportAgent> current_;  // agents as of this frame
+    std::vector<uint8_t> delta_frame_;
+    std::vector<uint8_t> keyframe_;
+    uint64_t sequence_ = 0;
+    std::shared_ptr<Metrics> metrics_;
+    const int SEND_BUFFER_BYTES_ = 4 << 20; // room for a keyframe of many thousands of agents
+    const int MAX_VIEWERS_ = 16;
+};
+
+}  // namespace rideshare
+
+#endif  // SNAPSHOT_STREAMER_H_
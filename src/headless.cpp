@@ -0,0 +1,38 @@
+/**
+ * @file headless.cpp
+ * @brief Simulate ridesharing without any graphics, e.g. for profiling or streaming to external viewers.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "argparser/simple_parser.h"
+#include "simulation/simulation.h"
+
+int main(int argc, char *argv[]) {
+    // Parse any arguments; those only for graphics are ignored
+    std::unordered_map<std::string, std::string> settings = rideshare::SimpleParser().ParseArgs(argc, argv);
+
+    // Read the map and simulate on it, with output only from metrics and any exports
+    rideshare::Simulation simulation(settings);
+    simulation.Start();
+
+    int duration = std::stoi(settings["duration"]);
+    if (duration == 0) {
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(60));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(duration));
+
+    // Simulation threads never finish on their own, so exit without waiting on them
+    std::cout << std::flush;
+    std::quick_exit(0);
+}
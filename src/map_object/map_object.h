@@ -10,7 +10,9 @@
 #define MAP_OBJECT_H_
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <utility>
 #include <vector>
 
 #include "mapping/coordinate.h"
@@ -29,6 +31,8 @@ enum DrawMarker {
     triangle_down,
 };
 
+// Fields used each cycle as objects move come first, and derived classes put their own right after them,
+//  ahead of fields only used now and then
 class MapObject {
   public:
     // Constructor / Destructor
@@ -41,14 +45,15 @@ class MapObject {
     void SetDestination(const Coordinate &destination) { destination_ = destination; }
     void SetColors(int blue, int green, int red) { blue_ = blue; green_ = green; red_ = red; }
     void SetId(int id) { id_ = id; }
-    void SetPath(std::vector<Model::Node> path) { path_ = path; }
+    void SetPath(std::vector<Model::Node> path, std::vector<int> path_nodes) { path_ = std::move(path); path_nodes_ = std::move(path_nodes); }
     Coordinate GetPosition() { return position_; }
     Coordinate GetDestination() { return destination_; }
     int Blue() { return blue_; }
     int Green() { return green_; }
     int Red() { return red_; }
     int Id() { return id_; }
-    std::vector<Model::Node> Path() { return path_; }
+    const std::vector<Model::Node> &Path() { return path_; }
+    const std::vector<int> &PathNodes() { return path_nodes_; }
 
     // Movement
     virtual void IncrementalMove() {};
@@ -69,14 +74,17 @@ class MapObject {
     }
 
     // Member variables
-    int id_;
-    int failures_ = 0;
-    const double distance_per_cycle_; // max distance to move per cycle for smooth-looking movement
-    int MAX_FAILURES_ = 10; // max failures before object will be removed (likely stuck)
+    // Each cycle
     Coordinate position_;
     Coordinate destination_;
-    int blue_, green_, red_; // Visualization colors
+    const double distance_per_cycle_; // max distance to move per cycle for smooth-looking movement
     std::vector<Model::Node> path_; // path made by route planner from start position to destination
+    int id_;
+    // Now and then
+    int failures_ = 0;
+    static constexpr int MAX_FAILURES_ = 10; // max failures before object will be removed (likely stuck)
+    uint8_t blue_, green_, red_; // Visualization colors
+    std::vector<int> path_nodes_;   // road node index of each position in path_
   
   private:
     // Set visualization colors out of 255
@@ -0,0 +1,110 @@
+/**
+ * @file object_pool.cpp
+ * @brief Implementation of thread-cached free lists of cache-line aligned blocks.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "object_pool.h"
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace rideshare {
+
+namespace {
+
+// Set as a thread's cache is destroyed; trivially destructible, so still safe to read after
+thread_local bool cache_destroyed = false;
+
+}  // namespace
+
+BlockPool::Shared &BlockPool::SharedLists() {
+    // Never destroyed, as thread caches still return blocks to it while other statics are torn down
+    static Shared *shared = new Shared();
+    return *shared;
+}
+
+BlockPool::ThreadCache *BlockPool::Cache() {
+    thread_local ThreadCache cache;
+    return cache_destroyed ? nullptr : &cache;
+}
+
+BlockPool::ThreadCache::~ThreadCache() {
+    Shared &shared = SharedLists();
+    std::lock_guard<std::mutex> lck(shared.mutex);
+    for (int size_class = 0; size_class < (int)(MAX_BLOCK_ / CACHE_LINE_); ++size_class) {
+        Move(lists[size_class], shared.lists[size_class], lists[size_class].count);
+    }
+    cache_destroyed = true;
+}
+
+void BlockPool::Move(FreeList &from, FreeList &to, int count) {
+    for (int i = 0; i < count && from.head != nullptr; ++i) {
+        to.Push(from.Pop());
+    }
+}
+
+void BlockPool::Refill(FreeList &list, int size_class) {
+    Shared &shared = SharedLists();
+    std::lock_guard<std::mutex> lck(shared.mutex);
+    if (shared.lists[size_class].count == 0) {
+        // Carve a new chunk, starting on a cache line so every block does too
+        const size_t block_size = (size_class + 1) * CACHE_LINE_;
+        std::byte *chunk = static_cast<std::byte *>(::operator new(block_size * BLOCKS_PER_CHUNK_,
+                                                                   std::align_val_t(CACHE_LINE_)));
+        shared.chunks.emplace_back(chunk);
+        for (int i = 0; i < BLOCKS_PER_CHUNK_; ++i) {
+            shared.lists[size_class].Push(reinterpret_cast<FreeBlock *>(chunk + (i * block_size)));
+        }
+    }
+    Move(shared.lists[size_class], list, BATCH_);
+}
+
+void *BlockPool::Allocate(size_t size) {
+    if (size == 0 || size > MAX_BLOCK_) {
+        return ::operator new(size, std::align_val_t(CACHE_LINE_));
+    }
+    int size_class = (size - 1) / CACHE_LINE_;
+    ThreadCache *cache = Cache();
+    if (cache == nullptr) {
+        // Thread is exiting, so go straight to the shared list
+        FreeList list;
+        Refill(list, size_class);
+        void *block = list.Pop();
+        std::lock_guard<std::mutex> lck(SharedLists().mutex);
+        Move(list, SharedLists().lists[size_class], list.count);
+        return block;
+    }
+    FreeList &list = cache->lists[size_class];
+    if (list.head == nullptr) {
+        Refill(list, size_class);
+    }
+    return list.Pop();
+}
+
+void BlockPool::Deallocate(void *block, size_t size) {
+    if (size == 0 || size > MAX_BLOCK_) {
+        ::operator delete(block, std::align_val_t(CACHE_LINE_));
+        return;
+    }
+    int size_class = (size - 1) / CACHE_LINE_;
+    ThreadCache *cache = Cache();
+    if (cache == nullptr) {
+        std::lock_guard<std::mutex> lck(SharedLists().mutex);
+        SharedLists().lists[size_class].Push(static_cast<FreeBlock *>(block));
+        return;
+    }
+    FreeList &list = cache->lists[size_class];
+    list.Push(static_cast<FreeBlock *>(block));
+    if (list.count > 2 * BATCH_) {
+        // Mostly freeing blocks made elsewhere, so hand some back for the threads making them
+        Shared &shared = SharedLists();
+        std::lock_guard<std::mutex> lck(shared.mutex);
+        Move(list, shared.lists[size_class], BATCH_);
+    }
+}
+
+}  // namespace rideshare
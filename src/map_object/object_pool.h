@@ -0,0 +1,97 @@
+/**
+ * @file object_pool.h
+ * @brief Pooled, cache-line aligned allocation for map objects that are created and removed all the time.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef OBJECT_POOL_H_
+#define OBJECT_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rideshare {
+
+// Fixed-size blocks, each a whole number of cache lines, kept on free lists once freed instead of going back
+//  to the system allocator. Each thread allocates from and frees to its own list without locking, only
+//  trading batches of blocks with a shared list under a mutex when its own runs empty or grows too long
+//  (e.g. a thread freeing passengers that another thread created).
+class BlockPool {
+  public:
+    static constexpr size_t CACHE_LINE_ = 64;
+    static constexpr size_t MAX_BLOCK_ = 8 * CACHE_LINE_; // larger sizes go to the system allocator
+
+    // Allocate `size` bytes, aligned to a cache line
+    static void *Allocate(size_t size);
+    // Free memory from Allocate, given the same size
+    static void Deallocate(void *block, size_t size);
+
+  private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+    // A free list, as a singly linked list through the free blocks themselves
+    struct FreeList {
+        FreeBlock *head = nullptr;
+        int count = 0;
+        void Push(FreeBlock *block) { block->next = head; head = block; ++count; }
+        FreeBlock *Pop() { FreeBlock *block = head; head = block->next; --count; return block; }
+    };
+    // A single thread's free lists, one per size class, returned to the shared lists when the thread exits
+    struct ThreadCache {
+        FreeList lists[MAX_BLOCK_ / CACHE_LINE_];
+        ~ThreadCache();
+    };
+    // Shared free lists, and every chunk ever carved into blocks (kept until exit, as blocks are never returned)
+    struct Shared {
+        std::mutex mutex;
+        FreeList lists[MAX_BLOCK_ / CACHE_LINE_];
+        std::vector<void *> chunks;
+    };
+    static Shared &SharedLists();
+    // The calling thread's cache, or nullptr once it has exited (e.g. objects freed by static destructors)
+    static ThreadCache *Cache();
+    // Refill an empty thread list from the shared one, carving a new chunk if that is empty too
+    static void Refill(FreeList &list, int size_class);
+    // Move blocks from one list to another, up to `count` of them
+    static void Move(FreeList &from, FreeList &to, int count);
+
+    static constexpr int BATCH_ = 32; // blocks traded with the shared lists at once
+    static constexpr int BLOCKS_PER_CHUNK_ = 64;
+};
+
+// Standard allocator over BlockPool, e.g. for `std::allocate_shared<Passenger>(PoolAllocator<Passenger>(), ...)`,
+//  which then takes both the object and its reference count from a single pooled block
+template <typename T>
+class PoolAllocator {
+  public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(BlockPool::Allocate(n * sizeof(T))); }
+    void deallocate(T *p, size_t n) { BlockPool::Deallocate(p, n * sizeof(T)); }
+
+    // Stateless, so any two can free each other's memory
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const { return false; }
+};
+
+// Make a shared map object (or anything else) from the pool
+template <typename T, typename... Args>
+std::shared_ptr<T> MakePooled(Args &&...args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace rideshare
+
+#endif  // OBJECT_POOL_H_
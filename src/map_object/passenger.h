@@ -9,6 +9,8 @@
 #ifndef PASSENGER_H_
 #define PASSENGER_H_
 
+#include <chrono>
+
 #include "map_object.h"
 
 namespace rideshare {
@@ -26,21 +28,40 @@ class Passenger: public MapObject {
       at_ride,
     };
 
+    // Priority classes, where priority riders are served as if they had already waited a while
+    enum PriorityClass {
+      standard,
+      priority,
+    };
+
     // Getters / Setters
     int PassShape() { return pass_shape_; }
     int DestShape() { return dest_shape_; }
     int GetStatus() { return status_; }
     void SetStatus(int status) { status_ = status; }
     void SetWalkToPos(Model::Node& walk_to_pos) { walk_to_pos_ = walk_to_pos; }
+    int Priority() { return priority_; }
+    void SetPriority(int priority) { priority_ = priority; }
+    // When the passenger first requested a ride, kept through any failures or hand offs between zones
+    std::chrono::steady_clock::time_point RequestTime() { return request_time_; }
+    void SetRequestTime(std::chrono::steady_clock::time_point request_time) { request_time_ = request_time; }
+    // When the passenger gives up if still not matched to a ride, or never (the max time point)
+    std::chrono::steady_clock::time_point AbandonTime() { return abandon_time_; }
+    void SetAbandonTime(std::chrono::steady_clock::time_point abandon_time) { abandon_time_ = abandon_time; }
 
     // Movement
     void IncrementalMove();
   
   private:
-    int pass_shape_ = DrawMarker::diamond;
-    int dest_shape_ = DrawMarker::tilted_cross;
+    // Each cycle, following on from those of MapObject
     int status_ = PassengerStatus::no_ride_requested;
     Model::Node walk_to_pos_;
+    // Now and then
+    int pass_shape_ = DrawMarker::diamond;
+    int dest_shape_ = DrawMarker::tilted_cross;
+    int priority_ = PriorityClass::standard;
+    std::chrono::steady_clock::time_point request_time_;
+    std::chrono::steady_clock::time_point abandon_time_ = std::chrono::steady_clock::time_point::max();
 };
 
 }  // namespace rideshare
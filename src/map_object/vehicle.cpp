@@ -8,6 +8,9 @@
 
 #include "vehicle.h"
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <memory>
 
 #include "mapping/coordinate.h"
@@ -16,17 +19,11 @@
 
 namespace rideshare {
 
-void Vehicle::SetPassenger(std::shared_ptr<Passenger> passenger) {
-    passenger_ = passenger;
-    // Set passenger's destination as the vehicle's destination
-    SetDestination(passenger->GetDestination());
-}
-
 void Vehicle::SetPosition(const Coordinate &position) {
     position_ = position;
-    // If there is a passenger, match to the vehicle's position
-    if (passenger_ != nullptr) {
-        passenger_->SetPosition(position);
+    // Any passengers move with the vehicle
+    for (auto &passenger : passengers_) {
+        passenger->SetPosition(position);
     }
 }
 
@@ -36,12 +33,58 @@ void Vehicle::SetDestination(const Coordinate &destination) {
     ResetPathAndIndex();
 }
 
-void Vehicle::DropOffPassenger() {
-    // Clear out the passenger
-    passenger_.reset();
+std::deque<Stop>::iterator Vehicle::FindStop(int passenger_id, bool pickup, std::deque<Stop>::iterator start) {
+    return std::find_if(start, stops_.end(), [passenger_id, pickup](const Stop &stop) {
+        return stop.passenger_id == passenger_id && stop.pickup == pickup;
+    });
+}
+
+bool Vehicle::InsertStops(const StopInsertion &insertion) {
+    Stop old_next = stops_.empty() ? Stop() : stops_.front();
+    // Insert the pick up after its stop, or at the front if that stop was already made
+    auto pickup = stops_.begin();
+    if (insertion.pickup_after.passenger_id != -1) {
+        auto after = FindStop(insertion.pickup_after.passenger_id, insertion.pickup_after.pickup, stops_.begin());
+        if (after != stops_.end()) {
+            pickup = after + 1;
+        }
+    }
+    pickup = stops_.insert(pickup, insertion.pickup);
+    // Insert the drop off after its stop if still later than the pick up, otherwise right after the pick up
+    auto dropoff = FindStop(insertion.dropoff_after.passenger_id, insertion.dropoff_after.pickup, pickup);
+    dropoff = (dropoff == stops_.end()) ? pickup + 1 : dropoff + 1;
+    stops_.insert(dropoff, insertion.dropoff);
+    return old_next.passenger_id == -1 || !stops_.front().Matches(old_next);
+}
+
+bool Vehicle::RemoveStops(int passenger_id) {
+    bool next_changed = !stops_.empty() && stops_.front().passenger_id == passenger_id;
+    stops_.erase(std::remove_if(stops_.begin(), stops_.end(),
+                                [passenger_id](const Stop &stop) { return stop.passenger_id == passenger_id; }),
+                 stops_.end());
+    return next_changed;
+}
+
+void Vehicle::PickUpPassenger(std::shared_ptr<Passenger> passenger) {
+    passenger->SetPosition(position_);
+    passengers_.emplace_back(passenger);
+    auto pickup = FindStop(passenger->Id(), true, stops_.begin());
+    if (pickup != stops_.end()) {
+        stops_.erase(pickup);
+    }
+}
+
+void Vehicle::DropOffPassenger(int passenger_id) {
+    // Clear out the passenger and its stop
+    passengers_.erase(std::remove_if(passengers_.begin(), passengers_.end(),
+                                     [passenger_id](const std::shared_ptr<Passenger> &passenger) { return passenger->Id() == passenger_id; }),
+                      passengers_.end());
+    auto dropoff = FindStop(passenger_id, false, stops_.begin());
+    if (dropoff != stops_.end()) {
+        stops_.erase(dropoff);
+    }
     // Clear out failures as well, since had a successful ride
     failures_ = 0;
-    // TODO: May want more post-dropoff later
 }
 
 void Vehicle::IncrementalMove() {
@@ -59,8 +102,22 @@ void Vehicle::IncrementalMove() {
     }
 }
 
+double Vehicle::RemainingDistance() {
+    if (path_.empty()) {
+        return std::hypot(destination_.x - position_.x, destination_.y - position_.y);
+    }
+    double distance = 0.0;
+    Coordinate from = position_;
+    for (size_t i = path_index_; i < path_.size(); ++i) {
+        distance += std::hypot(path_[i].x - from.x, path_[i].y - from.y);
+        from = { .x = path_[i].x, .y = path_[i].y };
+    }
+    return distance;
+}
+
 void Vehicle::ResetPathAndIndex() {
     path_.clear();
+    path_nodes_.clear();
     path_index_ = 0;
 }
 
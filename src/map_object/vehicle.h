@@ -9,6 +9,7 @@
 #ifndef VEHICLE_H_
 #define VEHICLE_H_
 
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -28,39 +29,78 @@ enum VehicleState {
     driving_passenger,
 };
 
+// A planned pick up or drop off of a passenger, in the order the vehicle will make them
+struct Stop {
+    int passenger_id = -1; // -1 for no stop
+    bool pickup = false;
+    Coordinate location;
+
+    bool Matches(const Stop &other) const { return passenger_id == other.passenger_id && pickup == other.pickup; }
+};
+
+// Where to add a passenger's stops into a vehicle's plan: each goes just after its given stop,
+//  or at the front if that stop has no passenger (the drop off's stop may be the new pick up itself)
+struct StopInsertion {
+    Stop pickup;
+    Stop pickup_after;
+    Stop dropoff;
+    Stop dropoff_after;
+};
+
 class Vehicle: public MapObject {
   public:
     // Constructor / Destructor
-    Vehicle(double distance_per_cycle) : MapObject(distance_per_cycle) {}
+    Vehicle(double distance_per_cycle, int capacity) : MapObject(distance_per_cycle), CAPACITY_(capacity) {}
 
     // Getters / Setters
     int Shape() { return shape_; }
     int State() { return state_; }
     int PathIndex() { return path_index_; }
-    std::shared_ptr<Passenger> GetPassenger() { return passenger_; }
+    int Capacity() { return CAPACITY_; }
+    const std::vector<std::shared_ptr<Passenger>>& Passengers() { return passengers_; }
+    const std::deque<Stop>& Stops() { return stops_; }
+    // Whether already offered for its next passenger while still on its way to a drop off
+    bool ChainRequested() { return chain_requested_; }
     void SetState(VehicleState state) { state_ = state; }
-    void SetPassenger(std::shared_ptr<Passenger> passenger);
-    // Override base class - also set passenger position if there is one to match vehicle
+    void SetChainRequested(bool chain_requested) { chain_requested_ = chain_requested; }
+    // Override base class - also set positions of any passengers to match vehicle
     void SetPosition(const Coordinate &position);
     // Override base class - use ResetPathAndIndex within so will get a new path and increment properly
     void SetDestination(const Coordinate &destination);
 
+    // Stops
+    // Add a passenger's pick up and drop off into the planned stops, returning whether the next stop changed
+    bool InsertStops(const StopInsertion &insertion);
+    // Remove any stops for a passenger (e.g. if unreachable), returning whether the next stop changed
+    bool RemoveStops(int passenger_id);
+
     // Other functionality
-    // "Drop off" the passenger - remove the passenger and reset any failures
-    void DropOffPassenger();
+    // "Pick up" a passenger - add it to those riding, and remove its pick up stop
+    void PickUpPassenger(std::shared_ptr<Passenger> passenger);
+    // "Drop off" a passenger - remove it and its drop off stop, and reset any failures
+    void DropOffPassenger(int passenger_id);
     // Movement
     void IncrementalMove();
+    // Distance left to drive along the path to the destination (straight there if not yet routed)
+    double RemainingDistance();
     // Increment path index by 1
     void IncrementPathIndex() { ++path_index_; }
 
   private:
     // Clear the path and reset path index to zero so can increment along the path properly
     void ResetPathAndIndex();
+    // Position of a passenger's stop in the plan, searching from `start`, or end of the plan if not found
+    std::deque<Stop>::iterator FindStop(int passenger_id, bool pickup, std::deque<Stop>::iterator start);
 
-    std::shared_ptr<Passenger> passenger_;
-    int shape_ = DrawMarker::square;
+    // Each cycle, following on from those of MapObject
     int state_ = VehicleState::no_passenger_requested;
     int path_index_ = 0;
+    std::vector<std::shared_ptr<Passenger>> passengers_; // passengers currently riding, moved with the vehicle
+    bool chain_requested_ = false;
+    // Now and then
+    const int CAPACITY_; // max passengers riding at once
+    std::deque<Stop> stops_; // planned pick ups and drop offs, in order
+    int shape_ = DrawMarker::square;
 };
 
 }  // namespace rideshare
@@ -0,0 +1,119 @@
+/**
+ * @file point_grid.cpp
+ * @brief Implementation of bucketing points into grid cells, and searching rings of cells for the nearest.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "point_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+PointGrid::PointGrid(double min_x, double min_y, double max_x, double max_y, int cells_per_side) :
+                     MIN_X_(min_x), MIN_Y_(min_y),
+                     CELL_WIDTH_(std::max(max_x - min_x, 1e-9) / cells_per_side),
+                     CELL_HEIGHT_(std::max(max_y - min_y, 1e-9) / cells_per_side),
+                     CELLS_PER_SIDE_(cells_per_side) {
+    cell_offsets_.assign((cells_per_side * cells_per_side) + 1, 0);
+    cell_counts_.assign(cells_per_side * cells_per_side, 0);
+}
+
+int PointGrid::CellColumn(double x) const {
+    return std::clamp((int)((x - MIN_X_) / CELL_WIDTH_), 0, CELLS_PER_SIDE_ - 1);
+}
+
+int PointGrid::CellRow(double y) const {
+    return std::clamp((int)((y - MIN_Y_) / CELL_HEIGHT_), 0, CELLS_PER_SIDE_ - 1);
+}
+
+void PointGrid::Build(const std::vector<std::pair<int, Coordinate>> &points) {
+    // Count points per cell, then place each after those of earlier cells
+    std::fill(cell_offsets_.begin(), cell_offsets_.end(), 0);
+    point_cells_.resize(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        point_cells_[i] = (CellRow(points[i].second.y) * CELLS_PER_SIDE_) + CellColumn(points[i].second.x);
+        ++cell_offsets_[point_cells_[i] + 1];
+    }
+    for (size_t c = 1; c < cell_offsets_.size(); ++c) {
+        cell_counts_[c - 1] = cell_offsets_[c];
+        cell_offsets_[c] += cell_offsets_[c - 1];
+    }
+    cell_points_.resize(points.size());
+    std::vector<int> next(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (size_t i = 0; i < points.size(); ++i) {
+        cell_points_[next[point_cells_[i]]++] = points[i];
+    }
+}
+
+void PointGrid::Remove(int id, const Coordinate &position) {
+    int cell = (CellRow(position.y) * CELLS_PER_SIDE_) + CellColumn(position.x);
+    int begin = cell_offsets_[cell], end = begin + cell_counts_[cell];
+    for (int i = begin; i < end; ++i) {
+        if (cell_points_[i].first == id) {
+            // Order within a cell doesn't matter, so fill the gap with the cell's last point
+            cell_points_[i] = cell_points_[end - 1];
+            --cell_counts_[cell];
+            return;
+        }
+    }
+}
+
+std::vector<int> PointGrid::Nearest(const Coordinate &position, int k, const std::function<bool(int)> &keep) const {
+    if (k <= 0) {
+        return {};
+    }
+    const int column = CellColumn(position.x);
+    const int row = CellRow(position.y);
+    std::vector<std::pair<double, int>> found; // distance, id
+
+    // Search rings of cells outward, until the k-th nearest so far is closer than anything in the next ring
+    const double ring_size = std::min(CELL_WIDTH_, CELL_HEIGHT_);
+    for (int ring = 0; ring < CELLS_PER_SIDE_; ++ring) {
+        for (int r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= CELLS_PER_SIDE_) {
+                continue;
+            }
+            // Only the ring's edge cells; inner cells were searched in earlier rings
+            int step = (r == row - ring || r == row + ring) ? 1 : std::max(1, 2 * ring);
+            for (int c = column - ring; c <= column + ring; c += step) {
+                if (c < 0 || c >= CELLS_PER_SIDE_) {
+                    continue;
+                }
+                int cell = (r * CELLS_PER_SIDE_) + c;
+                for (int i = cell_offsets_[cell]; i < cell_offsets_[cell] + cell_counts_[cell]; ++i) {
+                    const auto &[id, point] = cell_points_[i];
+                    if (keep && !keep(id)) {
+                        continue;
+                    }
+                    found.emplace_back(std::hypot(point.x - position.x, point.y - position.y), id);
+                }
+            }
+        }
+        // Anything in a further ring is at least `ring` whole cells away
+        if ((int)found.size() >= k) {
+            std::nth_element(found.begin(), found.begin() + (k - 1), found.end());
+            if (found[k - 1].first <= ring * ring_size) {
+                break;
+            }
+        }
+    }
+
+    int count = std::min(k, (int)found.size());
+    std::partial_sort(found.begin(), found.begin() + count, found.end());
+    std::vector<int> nearest;
+    for (int i = 0; i < count; ++i) {
+        nearest.emplace_back(found[i].second);
+    }
+    return nearest;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,53 @@
+/**
+ * @file point_grid.h
+ * @brief Uniform grid over moving points (e.g. open vehicles), rebuilt as they move, for finding the k nearest to a position.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef POINT_GRID_H_
+#define POINT_GRID_H_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+class PointGrid {
+  public:
+    // Constructor / Destructor
+    // Square-ish cells over the given bounds; points outside them are kept in the nearest edge cell
+    PointGrid(double min_x, double min_y, double max_x, double max_y, int cells_per_side);
+
+    // Replace all points with the given ids and positions, reusing memory from the last build
+    void Build(const std::vector<std::pair<int, Coordinate>> &points);
+    // Take out a point, given the position it was built with, e.g. once a vehicle is matched
+    void Remove(int id, const Coordinate &position);
+    // Ids of up to `k` points nearest to a position (straight line), closest first, only counting those `keep`
+    //  accepts if given (e.g. leaving out vehicles that already failed a passenger, without cutting k short)
+    std::vector<int> Nearest(const Coordinate &position, int k, const std::function<bool(int)> &keep = nullptr) const;
+
+  private:
+    // Grid cell containing a position, clamped to the grid
+    int CellColumn(double x) const;
+    int CellRow(double y) const;
+
+    // Member variables
+    // Points in cell c are cell_points_ [cell_offsets_[c], cell_offsets_[c] + cell_counts_[c]), as removing
+    //  a point only shrinks its cell's count
+    std::vector<int> cell_offsets_;
+    std::vector<int> cell_counts_;
+    std::vector<std::pair<int, Coordinate>> cell_points_;
+    std::vector<int> point_cells_; // scratch, cell of each point while building
+    const double MIN_X_, MIN_Y_;
+    const double CELL_WIDTH_, CELL_HEIGHT_;
+    const int CELLS_PER_SIDE_;
+};
+
+}  // namespace rideshare
+
+#endif  // POINT_GRID_H_
@@ -0,0 +1,81 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of metric recording and the periodic console report.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "metrics.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace rideshare {
+
+void Metrics::Record(const std::string &name, double value) {
+    std::lock_guard<std::mutex> lck(metrics_mutex_);
+    Series &series = series_[name];
+    ++series.count;
+    series.sum += value;
+    if (value > series.max) {
+        series.max = value;
+    }
+}
+
+void Metrics::Increment(const std::string &name, long amount) {
+    std::lock_guard<std::mutex> lck(metrics_mutex_);
+    counters_[name] += amount;
+}
+
+Metrics::Series Metrics::TakeSeries(const std::string &name) {
+    std::lock_guard<std::mutex> lck(metrics_mutex_);
+    Series series;
+    auto found = series_.find(name);
+    if (found != series_.end()) {
+        series = found->second;
+        series_.erase(found);
+    }
+    return series;
+}
+
+void Metrics::Simulate() {
+    // Launch Report function in a thread
+    threads.emplace_back(std::thread(&Metrics::Report, this));
+}
+
+void Metrics::Report() {
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(REPORT_INTERVAL_));
+
+        // Copy out and reset the interval series so recording threads are only blocked briefly
+        std::unique_lock<std::mutex> metrics_lck(metrics_mutex_);
+        std::map<std::string, Series> copied_series;
+        copied_series.swap(series_);
+        std::map<std::string, long> copied_counters(counters_);
+        metrics_lck.unlock();
+
+        if (copied_series.empty() && copied_counters.empty()) {
+            continue;
+        }
+
+        // Output a single block so it is not interleaved with other console notes
+        std::lock_guard<std::mutex> lck(mtx_);
+        std::cout << std::fixed << std::setprecision(2) << "Metrics:";
+        for (const auto & [name, series] : copied_series) {
+            std::cout << " " << name << " mean " << series.sum / series.count
+                      << " max " << series.max << " (n=" << series.count << ");";
+        }
+        for (const auto & [name, count] : copied_counters) {
+            std::cout << " " << name << " " << count << ";";
+        }
+        std::cout << std::defaultfloat << std::endl;
+    }
+}
+
+}  // namespace rideshare
@@ -0,0 +1,56 @@
+/**
+ * @file metrics.h
+ * @brief Collects named timing samples and counters, periodically reporting them to the console.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "concurrent/concurrent_object.h"
+
+namespace rideshare {
+
+class Metrics : public ConcurrentObject {
+  public:
+    // Summary of samples recorded during a single report interval
+    struct Series {
+        long count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+    };
+
+    // Constructor / Destructor
+    Metrics(int report_interval_ms) : REPORT_INTERVAL_(report_interval_ms) {};
+
+    // Recording
+    // Add a sample (e.g. a frame time in ms) to the named series for the current report interval
+    void Record(const std::string &name, double value);
+    // Add to a named counter, which accumulates over the whole run
+    void Increment(const std::string &name, long amount = 1);
+    // Take the named series' samples so far, starting it over, e.g. to read results without the report thread
+    Series TakeSeries(const std::string &name);
+
+    // Concurrent simulation
+    void Simulate();
+
+  private:
+    // Handles loop cycle of printing and resetting the interval series
+    void Report();
+
+    // Member variables
+    const int REPORT_INTERVAL_; // ms between each console report
+    std::map<std::string, Series> series_; // ordered so the report is stable between intervals
+    std::map<std::string, long> counters_;
+    std::mutex metrics_mutex_; // protect series_ and counters_ between recording threads and the report
+};
+
+}  // namespace rideshare
+
+#endif  // METRICS_H_
@@ -0,0 +1,135 @@
+/**
+ * @file distance_cache.cpp
+ * @brief Implementation of searching and caching one-to-all road distances.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "distance_cache.h"
+
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "routing/road_graph.h"
+
+namespace rideshare {
+
+float DistanceCache::Distance(int from, int to) {
+    if (from == to) {
+        return 0.0f;
+    }
+    // Avoid a new search if either end has already been searched from
+    if (row_lookup_.count(from) == 0 && row_lookup_.count(to) == 1) {
+        return Row(to)[from];
+    }
+    return Row(from)[to];
+}
+
+std::vector<float> DistanceCache::ToMany(int from, const std::vector<int> &targets) {
+    std::vector<float> distances(targets.size(), UNREACHABLE);
+    auto found = row_lookup_.find(from);
+    if (found != row_lookup_.end()) {
+        const std::vector<float> &row = found->second->second;
+        for (size_t t = 0; t < targets.size(); ++t) {
+            distances[t] = row[targets[t]];
+        }
+        return distances;
+    }
+
+    // Dijkstra's algorithm as in Search, but only settling nodes until the last target
+    search_distances_.resize(graph_.NodeCount(), UNREACHABLE);
+    std::unordered_map<int, std::vector<int>> waiting; // node, indices of targets at it
+    for (size_t t = 0; t < targets.size(); ++t) {
+        waiting[targets[t]].emplace_back(t);
+    }
+    using QueueEntry = std::pair<float, int>; // distance, node
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+    search_distances_[from] = 0.0f;
+    touched_.emplace_back(from);
+    open.emplace(0.0f, from);
+    while (!open.empty() && !waiting.empty()) {
+        auto [distance, node] = open.top();
+        open.pop();
+        // Skip stale entries for nodes already reached by a shorter route
+        if (distance > search_distances_[node]) {
+            continue;
+        }
+        auto target = waiting.find(node);
+        if (target != waiting.end()) {
+            for (int t : target->second) {
+                distances[t] = distance;
+            }
+            waiting.erase(target);
+        }
+        for (int e = graph_.EdgesBegin(node); e < graph_.EdgesEnd(node); ++e) {
+            int next = graph_.EdgeTarget(e);
+            float next_distance = distance + graph_.EdgeWeight(e);
+            if (next_distance < search_distances_[next]) {
+                if (search_distances_[next] == UNREACHABLE) {
+                    touched_.emplace_back(next);
+                }
+                search_distances_[next] = next_distance;
+                open.emplace(next_distance, next);
+            }
+        }
+    }
+    // Leave the scratch distances all unreached for next time
+    for (int node : touched_) {
+        search_distances_[node] = UNREACHABLE;
+    }
+    touched_.clear();
+    return distances;
+}
+
+const std::vector<float> &DistanceCache::Row(int node) {
+    auto found = row_lookup_.find(node);
+    if (found != row_lookup_.end()) {
+        // Move to the front as most recently used
+        rows_.splice(rows_.begin(), rows_, found->second);
+        return rows_.front().second;
+    }
+
+    // Reuse the least recently used row's memory once full
+    std::vector<float> distances;
+    if ((int)rows_.size() >= MAX_ROWS_ && !rows_.empty()) {
+        row_lookup_.erase(rows_.back().first);
+        distances = std::move(rows_.back().second);
+        rows_.pop_back();
+    }
+    Search(node, distances);
+    rows_.emplace_front(node, std::move(distances));
+    row_lookup_[node] = rows_.begin();
+    return rows_.front().second;
+}
+
+void DistanceCache::Search(int source, std::vector<float> &distances) {
+    distances.assign(graph_.NodeCount(), UNREACHABLE);
+    using QueueEntry = std::pair<float, int>; // distance, node
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> open;
+
+    distances[source] = 0.0f;
+    open.emplace(0.0f, source);
+    while (!open.empty()) {
+        auto [distance, node] = open.top();
+        open.pop();
+        // Skip stale entries for nodes already reached by a shorter route
+        if (distance > distances[node]) {
+            continue;
+        }
+        for (int e = graph_.EdgesBegin(node); e < graph_.EdgesEnd(node); ++e) {
+            int next = graph_.EdgeTarget(e);
+            float next_distance = distance + graph_.EdgeWeight(e);
+            if (next_distance < distances[next]) {
+                distances[next] = next_distance;
+                open.emplace(next_distance, next);
+            }
+        }
+    }
+}
+
+}  // namespace rideshare
@@ -0,0 +1,57 @@
+/**
+ * @file distance_cache.h
+ * @brief Least recently used cache of one-to-all road distances, for repeatedly comparing distances between stops.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef DISTANCE_CACHE_H_
+#define DISTANCE_CACHE_H_
+
+#include <limits>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "routing/road_graph.h"
+
+namespace rideshare {
+
+// Note: Not thread-safe, so each cache should only be used from a single thread (e.g. the ride matcher's)
+class DistanceCache {
+  public:
+    // Constructor / Destructor
+    DistanceCache(const RoadGraph &graph, int max_rows) : graph_(graph), MAX_ROWS_(max_rows) {};
+
+    // Road distance between two nodes, or UNREACHABLE. Roads are two-way, so this uses either node's
+    //  row if cached, only searching from `from` if neither is
+    float Distance(int from, int to);
+    // Make sure the row of distances from a node is cached, e.g. for a new request's pickup and dropoff
+    //  before comparing them against many stops
+    void Warm(int node) { Row(node); }
+    // Road distances from a node to only a few targets (or UNREACHABLE), from its cached row if there is one,
+    //  or else a single search that stops once every target is reached, and isn't cached
+    std::vector<float> ToMany(int from, const std::vector<int> &targets);
+
+    static constexpr float UNREACHABLE = std::numeric_limits<float>::infinity();
+
+  private:
+    // Distances from a node to all others, searching and caching them if not already, and marking as most recently used
+    const std::vector<float> &Row(int node);
+    // Fill in distances from a node to all others (Dijkstra's algorithm)
+    void Search(int source, std::vector<float> &distances);
+
+    // Member variables
+    const RoadGraph &graph_;
+    std::vector<float> search_distances_; // scratch for ToMany, reset only where touched
+    std::vector<int> touched_;
+    const int MAX_ROWS_;
+    std::list<std::pair<int, std::vector<float>>> rows_; // most recently used first
+    std::unordered_map<int, std::list<std::pair<int, std::vector<float>>>::iterator> row_lookup_;
+};
+
+}  // namespace rideshare
+
+#endif  // DISTANCE_CACHE_H_
@@ -0,0 +1,172 @@
+/**
+ * @file road_graph.cpp
+ * @brief Implementation of building the road adjacency and nearest node grid.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "road_graph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+
+namespace rideshare {
+
+RoadGraph::RoadGraph(const Model &model) : model_(model), origin_x_(model.MinLon()), origin_y_(model.MinLat()) {
+    const std::vector<Model::Node> &nodes = model.Nodes();
+    const int node_count = nodes.size();
+    points_.reserve(node_count);
+    for (const Model::Node &node : nodes) {
+        points_.emplace_back(ToLocal((Coordinate){.x = node.x, .y = node.y}));
+    }
+
+    // Gather each road segment once per direction, with its road speed, then bucket by source node
+    std::vector<std::tuple<int, int, float>> edges; // from, to, speed
+    std::vector<bool> on_road(node_count, false);
+    for (const Model::Road &road : model.Roads()) {
+        const std::vector<int> &way_nodes = model.Ways()[road.way].nodes;
+        const float speed = RoadSpeed(road.type);
+        for (size_t i = 0; i < way_nodes.size(); ++i) {
+            on_road[way_nodes[i]] = true;
+            if (i > 0 && way_nodes[i - 1] != way_nodes[i]) {
+                edges.emplace_back(way_nodes[i - 1], way_nodes[i], speed);
+                edges.emplace_back(way_nodes[i], way_nodes[i - 1], speed);
+            }
+        }
+    }
+    // Fastest first among duplicates, which is then the one kept
+    std::sort(edges.begin(), edges.end(), [](const auto &edge1, const auto &edge2) {
+        return std::make_tuple(std::get<0>(edge1), std::get<1>(edge1), -std::get<2>(edge1)) <
+               std::make_tuple(std::get<0>(edge2), std::get<1>(edge2), -std::get<2>(edge2));
+    });
+    edges.erase(std::unique(edges.begin(), edges.end(), [](const auto &edge1, const auto &edge2) {
+        return std::get<0>(edge1) == std::get<0>(edge2) && std::get<1>(edge1) == std::get<1>(edge2);
+    }), edges.end());
+
+    offsets_.assign(node_count + 1, 0);
+    for (const auto &edge : edges) {
+        ++offsets_[std::get<0>(edge) + 1];
+    }
+    for (int n = 0; n < node_count; ++n) {
+        offsets_[n + 1] += offsets_[n];
+    }
+    targets_.reserve(edges.size());
+    weights_.reserve(edges.size());
+    times_.reserve(edges.size());
+    for (const auto &[from, to, speed] : edges) {
+        targets_.emplace_back(to);
+        weights_.emplace_back(std::hypot(nodes[from].x - nodes[to].x, nodes[from].y - nodes[to].y));
+        times_.emplace_back(weights_.back() / speed);
+        max_speed_ = std::max(max_speed_, speed);
+    }
+
+    // Square grid cells covering every road node
+    double max_x = std::numeric_limits<double>::lowest(), max_y = std::numeric_limits<double>::lowest();
+    grid_min_x_ = grid_min_y_ = std::numeric_limits<double>::max();
+    for (int n = 0; n < node_count; ++n) {
+        if (on_road[n]) {
+            grid_min_x_ = std::min(grid_min_x_, nodes[n].x);
+            grid_min_y_ = std::min(grid_min_y_, nodes[n].y);
+            max_x = std::max(max_x, nodes[n].x);
+            max_y = std::max(max_y, nodes[n].y);
+        }
+    }
+    if (max_x < grid_min_x_) {
+        // No roads, so a single empty cell
+        grid_min_x_ = grid_min_y_ = max_x = max_y = 0.0;
+    }
+    cell_size_ = std::max({ max_x - grid_min_x_, max_y - grid_min_y_, 1e-9 }) / GRID_CELLS_PER_SIDE_;
+    grid_columns_ = std::max(1, (int)std::ceil((max_x - grid_min_x_) / cell_size_));
+    grid_rows_ = std::max(1, (int)std::ceil((max_y - grid_min_y_) / cell_size_));
+
+    cell_offsets_.assign((grid_columns_ * grid_rows_) + 1, 0);
+    for (int n = 0; n < node_count; ++n) {
+        if (on_road[n]) {
+            ++cell_offsets_[(CellRow(nodes[n].y) * grid_columns_) + CellColumn(nodes[n].x) + 1];
+        }
+    }
+    for (size_t c = 1; c < cell_offsets_.size(); ++c) {
+        cell_offsets_[c] += cell_offsets_[c - 1];
+    }
+    cell_nodes_.resize(cell_offsets_.back());
+    cell_points_.resize(cell_offsets_.back());
+    std::vector<int> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (int n = 0; n < node_count; ++n) {
+        if (on_road[n]) {
+            int i = fill[(CellRow(nodes[n].y) * grid_columns_) + CellColumn(nodes[n].x)]++;
+            cell_nodes_[i] = n;
+            cell_points_[i] = points_[n];
+        }
+    }
+}
+
+float RoadGraph::RoadSpeed(Model::Road::Type type) {
+    switch (type) {
+        case Model::Road::Motorway: return 2.5f;
+        case Model::Road::Trunk: return 2.0f;
+        case Model::Road::Primary: return 1.6f;
+        case Model::Road::Secondary: return 1.4f;
+        case Model::Road::Tertiary: return 1.2f;
+        case Model::Road::Residential: return 1.0f;
+        case Model::Road::Unclassified: return 0.8f;
+        default: return 0.6f; // service roads, parking lots and the like
+    }
+}
+
+int RoadGraph::CellColumn(double x) const {
+    return std::clamp((int)((x - grid_min_x_) / cell_size_), 0, grid_columns_ - 1);
+}
+
+int RoadGraph::CellRow(double y) const {
+    return std::clamp((int)((y - grid_min_y_) / cell_size_), 0, grid_rows_ - 1);
+}
+
+int RoadGraph::NearestNode(const Coordinate &position) const {
+    const LocalPoint local = ToLocal(position);
+    const int column = CellColumn(position.x);
+    const int row = CellRow(position.y);
+    int nearest = -1;
+    float nearest_squared = std::numeric_limits<float>::max();
+
+    // Search rings of cells outward, until no closer node could be in the next ring
+    const int max_ring = std::max(grid_columns_, grid_rows_);
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        for (int r = row - ring; r <= row + ring; ++r) {
+            if (r < 0 || r >= grid_rows_) {
+                continue;
+            }
+            // Only the ring's edge cells; inner cells were searched in earlier rings
+            int step = (r == row - ring || r == row + ring) ? 1 : std::max(1, 2 * ring);
+            for (int c = column - ring; c <= column + ring; c += step) {
+                if (c < 0 || c >= grid_columns_) {
+                    continue;
+                }
+                int cell = (r * grid_columns_) + c;
+                for (int i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+                    float dx = cell_points_[i].x - local.x;
+                    float dy = cell_points_[i].y - local.y;
+                    float squared = (dx * dx) + (dy * dy);
+                    if (squared < nearest_squared) {
+                        nearest_squared = squared;
+                        nearest = cell_nodes_[i];
+                    }
+                }
+            }
+        }
+        // Anything in a further ring is at least `ring` whole cells away
+        if (nearest != -1 && nearest_squared <= (float)((ring * cell_size_) * (ring * cell_size_))) {
+            break;
+        }
+    }
+    return nearest;
+}
+
+}  // namespace rideshare
@@ -0,0 +1,87 @@
+/**
+ * @file road_graph.h
+ * @brief Static road network adjacency in compressed (CSR) form, with a grid index for finding the nearest road node.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef ROAD_GRAPH_H_
+#define ROAD_GRAPH_H_
+
+#include <vector>
+
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+
+namespace rideshare {
+
+class RoadGraph {
+  public:
+    // Constructor / Destructor
+    // Builds edges between consecutive nodes of every road, in both directions. Node indices
+    //  are the same as the model's, so they match route planner path nodes
+    RoadGraph(const Model &model);
+
+    // Road node position as a float offset from the map's minimum corner, in the model's units. Half the size
+    //  of Model::Node, and offsets keep float precise to well under a meter across a city, where whole
+    //  longitudes and latitudes would not be
+    struct LocalPoint {
+        float x;
+        float y;
+    };
+
+    // Getters
+    int NodeCount() const { return (int)offsets_.size() - 1; }
+    const Model &GetModel() const { return model_; }
+    // Exact position, e.g. for paths to follow
+    const Model::Node &Position(int node) const { return model_.Nodes()[node]; }
+    // Compact position, e.g. for search heuristics
+    const LocalPoint &Point(int node) const { return points_[node]; }
+    // A map position in the same local frame as Point
+    LocalPoint ToLocal(const Coordinate &position) const {
+        return {(float)(position.x - origin_x_), (float)(position.y - origin_y_)};
+    }
+    // Edges leaving a node are [EdgesBegin, EdgesEnd) within EdgeTarget and EdgeWeight
+    int EdgesBegin(int node) const { return offsets_[node]; }
+    int EdgesEnd(int node) const { return offsets_[node + 1]; }
+    int EdgeTarget(int edge) const { return targets_[edge]; }
+    float EdgeWeight(int edge) const { return weights_[edge]; }
+    // Time to drive an edge, as its length over the relative speed of its road type
+    float EdgeTime(int edge) const { return times_[edge]; }
+    // Fastest relative speed of any edge, so straight line distance over it never overestimates time
+    float MaxSpeed() const { return max_speed_; }
+
+    // Speed of a road type relative to a residential street
+    static float RoadSpeed(Model::Road::Type type);
+
+    // Closest road node to a position, as with RouteModel::FindClosestNode but without scanning every road
+    int NearestNode(const Coordinate &position) const;
+
+  private:
+    // Grid cell containing a position, clamped to the grid
+    int CellColumn(double x) const;
+    int CellRow(double y) const;
+
+    // Member variables
+    const Model &model_;
+    double origin_x_, origin_y_; // map's minimum corner
+    std::vector<LocalPoint> points_;
+    // Adjacency: edges of node n are targets_ / weights_ [offsets_[n], offsets_[n + 1])
+    std::vector<int> offsets_;
+    std::vector<int> targets_;
+    std::vector<float> weights_; // straight line distance, in the same units as A* search
+    std::vector<float> times_;   // weight over road speed, using the fastest road if a segment is on several
+    float max_speed_ = 1.0f;
+    // Uniform grid over road nodes: nodes in cell c are cell_nodes_ [cell_offsets_[c], cell_offsets_[c + 1])
+    std::vector<int> cell_offsets_;
+    std::vector<int> cell_nodes_;
+    std::vector<LocalPoint> cell_points_; // point of each of cell_nodes_, so a cell's are scanned contiguously
+    double grid_min_x_, grid_min_y_, cell_size_;
+    int grid_columns_, grid_rows_;
+    const int GRID_CELLS_PER_SIDE_ = 64;
+};
+
+}  // namespace rideshare
+
+#endif  // ROAD_GRAPH_H_
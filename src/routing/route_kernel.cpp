@@ -0,0 +1,60 @@
+/**
+ * @file route_kernel.cpp
+ * @brief Instantiation of the specialized routing kernels and the table picking between them.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "route_kernel.h"
+
+#include <memory>
+#include <vector>
+
+#include "routing/road_graph.h"
+
+namespace rideshare {
+
+template <int COST, typename Cost, template <typename> class Heuristic>
+float RouteKernels::Run(RouteKernels &kernels, int from, int to, std::vector<int> &path_nodes) {
+    Cost cost{kernels.graph_};
+    const LandmarkTable *landmark_table = Heuristic<Cost>::USES_LANDMARKS_ ? kernels.Landmarks(COST) : nullptr;
+    Heuristic<Cost> heuristic(kernels.graph_, cost, landmark_table, to);
+    return RouteSearch(kernels.graph_, cost, heuristic, kernels.visited_, kernels.open_, from, to, path_nodes);
+}
+
+const RouteKernels::Kernel RouteKernels::KERNELS_[2][2] = {
+    { &Run<distance, DistanceCost, EuclideanHeuristic>, &Run<distance, DistanceCost, LandmarkHeuristic> },
+    { &Run<time, TimeCost, EuclideanHeuristic>, &Run<time, TimeCost, LandmarkHeuristic> },
+};
+
+float RouteKernels::SearchGeneric(int cost, int heuristic, int from, int to, std::vector<int> &path_nodes) {
+    GenericCost generic_cost;
+    if (cost == RouteCost::time) {
+        TimeCost time_cost{graph_};
+        generic_cost = {[time_cost](int e) { return time_cost.Edge(e); }, time_cost.PerDistance()};
+    } else {
+        DistanceCost distance_cost{graph_};
+        generic_cost = {[distance_cost](int e) { return distance_cost.Edge(e); }, distance_cost.PerDistance()};
+    }
+    GenericHeuristic generic_heuristic;
+    if (heuristic == RouteHeuristic::landmarks) {
+        generic_heuristic.bound = LandmarkHeuristic<GenericCost>(graph_, generic_cost, Landmarks(cost), to);
+    } else {
+        generic_heuristic.bound = EuclideanHeuristic<GenericCost>(graph_, generic_cost, nullptr, to);
+    }
+    return RouteSearch(graph_, generic_cost, generic_heuristic, visited_, open_, from, to, path_nodes);
+}
+
+const LandmarkTable *RouteKernels::Landmarks(int cost) {
+    if (landmarks_[cost] == nullptr) {
+        if (cost == RouteCost::time) {
+            landmarks_[cost] = std::make_unique<LandmarkTable>(graph_, TimeCost{graph_});
+        } else {
+            landmarks_[cost] = std::make_unique<LandmarkTable>(graph_, DistanceCost{graph_});
+        }
+    }
+    return landmarks_[cost].get();
+}
+
+}  // namespace rideshare
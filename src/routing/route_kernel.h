@@ -0,0 +1,328 @@
+/**
+ * @file route_kernel.h
+ * @brief A* search over the road graph, templated on cost, heuristic and visited set so each combination
+ *  compiles into its own fully inlined kernel, with a table to pick between them at runtime.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef ROUTE_KERNEL_H_
+#define ROUTE_KERNEL_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "routing/road_graph.h"
+
+namespace rideshare {
+
+// Cost policies: the cost of driving an edge, and the least cost per unit of straight line distance
+// Shortest distance
+struct DistanceCost {
+    const RoadGraph &graph;
+    float Edge(int edge) const { return graph.EdgeWeight(edge); }
+    float PerDistance() const { return 1.0f; }
+};
+// Quickest time, by road type
+struct TimeCost {
+    const RoadGraph &graph;
+    float Edge(int edge) const { return graph.EdgeTime(edge); }
+    float PerDistance() const { return 1.0f / graph.MaxSpeed(); }
+};
+
+// Least cost from each of a few landmarks to every node under one cost policy, for the landmark heuristic.
+//  Landmarks are picked far apart, each the node furthest from those already picked
+class LandmarkTable {
+  public:
+    template <typename Cost>
+    LandmarkTable(const RoadGraph &graph, const Cost &cost);
+
+    // Costs from each landmark to a node (UNREACHABLE_ if not connected), kept together per node
+    const float *Row(int node) const { return &costs_[node * COUNT_]; }
+
+    static constexpr int COUNT_ = 8;
+    static constexpr float UNREACHABLE_ = std::numeric_limits<float>::infinity();
+
+  private:
+    // Least cost from a node to all others (Dijkstra's algorithm)
+    template <typename Cost>
+    static void CostsFrom(const RoadGraph &graph, const Cost &cost, int source, std::vector<float> &costs);
+
+    std::vector<float> costs_; // node-major, COUNT_ per node
+};
+
+// Heuristic policies, set up once per search for its target, giving a lower bound on the cost from any node to it
+// Straight line distance between the graph's float points, in the cost's units
+template <typename Cost>
+class EuclideanHeuristic {
+  public:
+    static constexpr bool USES_LANDMARKS_ = false;
+
+    EuclideanHeuristic(const RoadGraph &graph, const Cost &cost, const LandmarkTable *, int target) :
+      graph_(graph), target_(graph.Point(target)), scale_(cost.PerDistance()) {};
+
+    float operator()(int node) const {
+        const RoadGraph::LocalPoint &point = graph_.Point(node);
+        float dx = point.x - target_.x;
+        float dy = point.y - target_.y;
+        return scale_ * std::sqrt((dx * dx) + (dy * dy));
+    }
+
+  private:
+    const RoadGraph &graph_;
+    const RoadGraph::LocalPoint target_;
+    const float scale_;
+};
+// Best of the triangle inequality bounds through each landmark (ALT). Roads are two-way, so costs from
+//  a landmark are also costs to it, and |cost(L, target) - cost(L, node)| <= cost(node, target)
+template <typename Cost>
+class LandmarkHeuristic {
+  public:
+    static constexpr bool USES_LANDMARKS_ = true;
+
+    LandmarkHeuristic(const RoadGraph &, const Cost &, const LandmarkTable *landmarks, int target) :
+      landmarks_(*landmarks), target_row_(landmarks->Row(target)) {};
+
+    float operator()(int node) const {
+        const float *row = landmarks_.Row(node);
+        float bound = 0.0f;
+        for (int l = 0; l < LandmarkTable::COUNT_; ++l) {
+            // Landmarks in another part of a disconnected network say nothing
+            if (row[l] != LandmarkTable::UNREACHABLE_ && target_row_[l] != LandmarkTable::UNREACHABLE_) {
+                bound = std::max(bound, std::fabs(target_row_[l] - row[l]));
+            }
+        }
+        return bound;
+    }
+
+  private:
+    const LandmarkTable &landmarks_;
+    const float *target_row_;
+};
+
+// Generic policies, calling through std::function as a single kernel handling any cost and heuristic would,
+//  kept to measure the specialized kernels against
+struct GenericCost {
+    std::function<float(int)> edge;
+    float per_distance;
+    float Edge(int e) const { return edge(e); }
+    float PerDistance() const { return per_distance; }
+};
+struct GenericHeuristic {
+    std::function<float(int)> bound;
+    float operator()(int node) const { return bound(node); }
+};
+
+// Visited set policies: the least cost found so far to each node reached in the current search, and its parent
+// Flat entries for every node, stamped with the search that set them, so a new search clears nothing
+class StampedVisited {
+  public:
+    void Begin(int node_count) {
+        if ((int)entries_.size() < node_count) {
+            entries_.resize(node_count);
+        }
+        if (++stamp_ == 0) {
+            // Wrapped around, so old stamps could look current
+            for (Entry &entry : entries_) {
+                entry.stamp = 0;
+            }
+            stamp_ = 1;
+        }
+    }
+    float Cost(int node) const {
+        const Entry &entry = entries_[node];
+        return (entry.stamp == stamp_) ? entry.cost : std::numeric_limits<float>::infinity();
+    }
+    int Parent(int node) const { return entries_[node].parent; }
+    void Set(int node, float cost, int parent) { entries_[node] = {cost, parent, stamp_}; }
+
+  private:
+    struct Entry {
+        float cost;
+        int parent;
+        uint32_t stamp = 0;
+    };
+    std::vector<Entry> entries_;
+    uint32_t stamp_ = 0;
+};
+// Only the nodes reached, hashed, for searches that touch little of a very large network
+class HashedVisited {
+  public:
+    void Begin(int) { entries_.clear(); }
+    float Cost(int node) const {
+        auto found = entries_.find(node);
+        return (found != entries_.end()) ? found->second.first : std::numeric_limits<float>::infinity();
+    }
+    int Parent(int node) const { return entries_.at(node).second; }
+    void Set(int node, float cost, int parent) { entries_[node] = {cost, parent}; }
+
+  private:
+    std::unordered_map<int, std::pair<float, int>> entries_; // node, (cost, parent)
+};
+
+// Open list entry, ordered by estimate (cost so far plus heuristic)
+struct RouteQueueEntry {
+    float estimate;
+    float cost;
+    int node;
+};
+
+// A* search from one road node to another, returning the least cost (or infinity if unreachable) and filling
+//  in the route's nodes from start to finish. Entries are never removed from the open list, only skipped once
+//  a cheaper route to their node is found, so heuristics only need to be admissible
+template <typename Cost, typename Heuristic, typename Visited>
+float RouteSearch(const RoadGraph &graph, const Cost &cost, const Heuristic &heuristic, Visited &visited,
+                  std::vector<RouteQueueEntry> &open, int from, int to, std::vector<int> &path_nodes) {
+    // Min-heap on estimate, going deeper first on ties
+    auto later = [](const RouteQueueEntry &entry1, const RouteQueueEntry &entry2) {
+        return (entry1.estimate > entry2.estimate) || (entry1.estimate == entry2.estimate && entry1.cost < entry2.cost);
+    };
+    visited.Begin(graph.NodeCount());
+    open.clear();
+    visited.Set(from, 0.0f, -1);
+    open.push_back({heuristic(from), 0.0f, from});
+
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), later);
+        RouteQueueEntry current = open.back();
+        open.pop_back();
+        // Skip stale entries for nodes since reached by a cheaper route
+        if (current.cost > visited.Cost(current.node)) {
+            continue;
+        }
+        if (current.node == to) {
+            path_nodes.clear();
+            for (int node = to; node != -1; node = visited.Parent(node)) {
+                path_nodes.emplace_back(node);
+            }
+            std::reverse(path_nodes.begin(), path_nodes.end());
+            return current.cost;
+        }
+        for (int e = graph.EdgesBegin(current.node); e < graph.EdgesEnd(current.node); ++e) {
+            int next = graph.EdgeTarget(e);
+            float next_cost = current.cost + cost.Edge(e);
+            if (next_cost < visited.Cost(next)) {
+                visited.Set(next, next_cost, current.node);
+                open.push_back({next_cost + heuristic(next), next_cost, next});
+                std::push_heap(open.begin(), open.end(), later);
+            }
+        }
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+// The specialized kernel for each combination of cost and heuristic, looked up by enum values at runtime.
+// Note: Not thread-safe, as searches share the visited set and open list (e.g. the route planner locks around it)
+class RouteKernels {
+  public:
+    // Constructor / Destructor
+    RouteKernels(const RoadGraph &graph) : graph_(graph) {};
+
+    // Enums for kernel choices
+    enum RouteCost {
+      distance,
+      time,
+    };
+    enum RouteHeuristic {
+      euclidean,
+      landmarks,
+    };
+
+    // Least cost from one road node to another under the given cost and heuristic, filling in the route's nodes
+    //  from start to finish, or UNREACHABLE. Landmarks for a cost are picked and searched from on first use
+    float Search(int cost, int heuristic, int from, int to, std::vector<int> &path_nodes) {
+        return KERNELS_[cost][heuristic](*this, from, to, path_nodes);
+    }
+    // The same search through the generic policies, for comparison
+    float SearchGeneric(int cost, int heuristic, int from, int to, std::vector<int> &path_nodes);
+
+    static constexpr float UNREACHABLE = std::numeric_limits<float>::infinity();
+
+  private:
+    using Kernel = float (*)(RouteKernels &kernels, int from, int to, std::vector<int> &path_nodes);
+
+    // A kernel, as instantiated for the table
+    template <int COST, typename Cost, template <typename> class Heuristic>
+    static float Run(RouteKernels &kernels, int from, int to, std::vector<int> &path_nodes);
+    // Landmarks for a cost, built if not already
+    const LandmarkTable *Landmarks(int cost);
+
+    // Member variables
+    static const Kernel KERNELS_[2][2]; // [RouteCost][RouteHeuristic]
+    const RoadGraph &graph_;
+    std::unique_ptr<LandmarkTable> landmarks_[2]; // per RouteCost
+    StampedVisited visited_;
+    std::vector<RouteQueueEntry> open_;
+};
+
+template <typename Cost>
+LandmarkTable::LandmarkTable(const RoadGraph &graph, const Cost &cost) {
+    const int node_count = graph.NodeCount();
+    costs_.assign(node_count * COUNT_, UNREACHABLE_);
+    // Start from the first node on a road, so it is somewhere in the network
+    int next = 0;
+    while (next < node_count && graph.EdgesBegin(next) == graph.EdgesEnd(next)) {
+        ++next;
+    }
+    if (next == node_count) {
+        return;
+    }
+
+    std::vector<float> costs;
+    std::vector<float> nearest_landmark(node_count, UNREACHABLE_);
+    CostsFrom(graph, cost, next, nearest_landmark);
+    for (int l = 0; l < COUNT_; ++l) {
+        // Next landmark is the reachable node furthest from any so far (or the start, for the first)
+        float furthest = -1.0f;
+        for (int n = 0; n < node_count; ++n) {
+            if (nearest_landmark[n] != UNREACHABLE_ && nearest_landmark[n] > furthest) {
+                furthest = nearest_landmark[n];
+                next = n;
+            }
+        }
+        CostsFrom(graph, cost, next, costs);
+        for (int n = 0; n < node_count; ++n) {
+            costs_[(n * COUNT_) + l] = costs[n];
+            nearest_landmark[n] = std::min(nearest_landmark[n], costs[n]);
+        }
+    }
+}
+
+template <typename Cost>
+void LandmarkTable::CostsFrom(const RoadGraph &graph, const Cost &cost, int source, std::vector<float> &costs) {
+    costs.assign(graph.NodeCount(), UNREACHABLE_);
+    std::vector<RouteQueueEntry> open;
+    auto later = [](const RouteQueueEntry &entry1, const RouteQueueEntry &entry2) { return entry1.cost > entry2.cost; };
+
+    costs[source] = 0.0f;
+    open.push_back({0.0f, 0.0f, source});
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), later);
+        RouteQueueEntry current = open.back();
+        open.pop_back();
+        if (current.cost > costs[current.node]) {
+            continue;
+        }
+        for (int e = graph.EdgesBegin(current.node); e < graph.EdgesEnd(current.node); ++e) {
+            int next = graph.EdgeTarget(e);
+            float next_cost = current.cost + cost.Edge(e);
+            if (next_cost < costs[next]) {
+                costs[next] = next_cost;
+                open.push_back({next_cost, next_cost, next});
+                std::push_heap(open.begin(), open.end(), later);
+            }
+        }
+    }
+}
+
+}  // namespace rideshare
+
+#endif  // ROUTE_KERNEL_H_
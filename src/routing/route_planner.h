@@ -9,50 +9,39 @@
 #ifndef ROUTE_PLANNER_H_
 #define ROUTE_PLANNER_H_
 
-#include <iostream>
 #include <memory>
 #include <mutex>
-#include <vector>
-#include <string>
 
-#include "mapping/route_model.h"
 #include "map_object/map_object.h"
+#include "routing/road_graph.h"
+#include "routing/route_kernel.h"
 
 namespace rideshare {
 
 class RoutePlanner {
   public:
     // Constructors / Destructors
-    RoutePlanner(RouteModel &model) : model_(model) {};
+    // Routes by one of the RouteKernels costs and heuristics, shortest distance by default
+    RoutePlanner(const RoadGraph &graph, int cost = RouteKernels::distance, int heuristic = RouteKernels::euclidean) :
+      graph_(graph), kernels_(graph), COST_(cost), HEURISTIC_(heuristic) {};
 
-    // Getters / Setters
+    // Getters
+    // Road network routed over, e.g. to snap positions onto its nearest node
+    const RoadGraph &Graph() const { return graph_; }
 
     // Primary functionality
+    // Set the object's path from its position to its destination, or leave it as is if unreachable
     void AStarSearch(std::shared_ptr<MapObject> map_obj);
 
   private:
-    // Route model-related variables
-    std::vector<RouteModel::Node*> open_list_;
-    RouteModel::Node *start_node_;
-    RouteModel::Node *end_node_;
-
-    // Mutex to ensure single access to certain pointers (model, nodes) during A* Search
+    // Mutex to ensure single access to the kernels' shared search space during A* Search
     std::mutex mtx_;
 
     // Other variables
-    RouteModel &model_;
-
-    // Functions
-    // Sort two nodes by h+g value (used by A*)
-    static bool Compare(RouteModel::Node* node1, RouteModel::Node* node2);
-    // Add all neighbors to a given node
-    void AddNeighbors(RouteModel::Node *current_node);
-    // Calculate the h-value for a node (distance)
-    float CalculateHValue(RouteModel::Node const *node);
-    // Construct in reverse the A* Search path, giving start -> finish
-    std::vector<Model::Node> ConstructFinalPath(RouteModel::Node *);
-    // Get the next node along a given A* Search path
-    RouteModel::Node *NextNode();
+    const RoadGraph &graph_;
+    RouteKernels kernels_;
+    const int COST_;
+    const int HEURISTIC_;
 };
 
 }  // namespace rideshare
@@ -0,0 +1,128 @@
+/**
+ * @file simulation.cpp
+ * @brief Implementation of reading map data, then creating, wiring together and starting the simulation.
+ *
+ * @cite OSM reading code adapted from https://github.com/udacity/CppND-Route-Planning-Project
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "simulation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rideshare {
+
+Simulation::Simulation(std::unordered_map<std::string, std::string> settings) :
+                       settings_(settings), model_(ReadMapData(settings["map"])),
+                       road_graph_(model_) {
+    srand((unsigned) time(NULL)); // Seed random number generator
+
+    // Create a shared route planner
+    route_planner_ = std::make_shared<RoutePlanner>(road_graph_);
+
+    // Create vehicles
+    vehicles_ = std::make_shared<VehicleManager>(&model_, route_planner_, std::stoi(settings_["vehicles"]),
+                                                std::stoi(settings_["capacity"]));
+    vehicles_->SetChainDispatch(std::stoi(settings_["chain"]));
+
+    // Create passenger queue
+    passengers_ = std::make_shared<PassengerQueue>(&model_, route_planner_, std::stoi(settings_["passengers"]),
+                                                   std::stoi(settings_["wait"]), std::stoi(settings_["wait_range"]));
+    passengers_->SetPatience(std::stoi(settings_["abandon"]) * 1000, settings_["patience"]);
+    passengers_->SetPriorityShare(std::stoi(settings_["priority"]));
+
+    // Create the ride matchers, one per zone, behind a router to them
+    zone_router_ = std::make_shared<ZoneRouter>(passengers_, vehicles_, model_, settings_["match"], road_graph_,
+                                                std::stoi(settings_["capacity"]), std::stoi(settings_["zones"]));
+
+    // Attach ride matchers to the other two
+    vehicles_->SetRideMatcher(zone_router_);
+    passengers_->SetRideMatcher(zone_router_);
+
+    // Create metrics, reported to the console every few seconds
+    metrics_ = std::make_shared<Metrics>(5000);
+
+    // Match quality vs. latency depends on how long requests are gathered for
+    zone_router_->SetMatchWindow(std::stoi(settings_["match_window"]), std::stoi(settings_["window_requests"]));
+    zone_router_->SetMetrics(metrics_);
+
+    // Let supply and demand set prices and the fleet size, if wanted
+    if (std::stoi(settings_["market"]) > 0) {
+        market_ = std::make_shared<Market>(model_, vehicles_, std::stoi(settings_["market"]) * 1000);
+        market_->SetMetrics(metrics_);
+        zone_router_->SetMarket(market_);
+        passengers_->SetMarket(market_);
+    }
+}
+
+void Simulation::Start() {
+    // Start the simulations
+    metrics_->Simulate();
+    zone_router_->Simulate();
+    vehicles_->Simulate();
+    passengers_->Simulate();
+
+    if (market_ != nullptr) {
+        market_->Simulate();
+    }
+
+    // Periodically send idle vehicles toward forecast demand, instead of only cruising at random
+    if (std::stoi(settings_["rebalance"]) > 0) {
+        rebalancer_ = std::make_shared<Rebalancer>(model_, vehicles_, &passengers_->Snapshots(), &vehicles_->Snapshots(),
+                                                   std::stoi(settings_["rebalance"]) * 1000);
+        rebalancer_->SetMetrics(metrics_);
+        rebalancer_->Simulate();
+    }
+
+    // Stream to external viewers, from the same snapshots any graphics draw from
+    if (!settings_["export"].empty()) {
+        streamer_ = std::make_shared<SnapshotStreamer>(settings_["export"]);
+        streamer_->AddSnapshotSource(&passengers_->Snapshots());
+        streamer_->AddSnapshotSource(&vehicles_->Snapshots());
+        streamer_->SetMetrics(metrics_);
+        streamer_->Simulate();
+    }
+
+    // Or write to shared memory, sized for every vehicle to be full on top of those waiting
+    if (!settings_["shared_memory"].empty()) {
+        uint32_t max_agents = ((1 + std::stoi(settings_["capacity"])) * vehicles_->MaxFleet()) +
+                              std::stoi(settings_["passengers"]);
+        ring_publisher_ = std::make_shared<RingPublisher>(settings_["shared_memory"], 64, max_agents);
+        ring_publisher_->AddSnapshotSource(&passengers_->Snapshots());
+        ring_publisher_->AddSnapshotSource(&vehicles_->Snapshots());
+        ring_publisher_->SetMetrics(metrics_);
+        ring_publisher_->Simulate();
+    }
+}
+
+std::vector<std::byte> Simulation::ReadMapData(const std::string &map) {
+    const std::string osm_data_file = "../data/" + map + ".osm";
+    std::cout << "Reading OpenStreetMap data from the following file: " << osm_data_file << std::endl;
+
+    std::ifstream is{osm_data_file, std::ios::binary | std::ios::ate};
+    if (!is) {
+        std::cout << "Failed to read." << std::endl;
+        return {};
+    }
+    auto size = is.tellg();
+    std::vector<std::byte> contents(size);
+    is.seekg(0);
+    is.read((char*)contents.data(), size);
+    if (contents.empty()) {
+        std::cout << "Failed to read." << std::endl;
+    }
+    return contents;
+}
+
+}  // namespace rideshare
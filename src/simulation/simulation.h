@@ -0,0 +1,68 @@
+/**
+ * @file simulation.h
+ * @brief Create and start everything needed to simulate ridesharing on a map, for any front-end.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "concurrent/passenger_queue.h"
+#include "concurrent/vehicle_manager.h"
+#include "concurrent/zone_router.h"
+#include "dispatch/market.h"
+#include "dispatch/rebalancer.h"
+#include "export/ring_publisher.h"
+#include "export/snapshot_streamer.h"
+#include "mapping/route_model.h"
+#include "metrics/metrics.h"
+#include "routing/road_graph.h"
+#include "routing/route_planner.h"
+
+namespace rideshare {
+
+class Simulation {
+  public:
+    // Constructor / Destructor
+    // Read map data and create all simulation objects from parsed command line settings
+    Simulation(std::unordered_map<std::string, std::string> settings);
+
+    // Getters
+    RouteModel &GetModel() { return model_; }
+    std::shared_ptr<VehicleManager> GetVehicles() { return vehicles_; }
+    std::shared_ptr<PassengerQueue> GetPassengers() { return passengers_; }
+    std::shared_ptr<Metrics> GetMetrics() { return metrics_; }
+
+    // Start every simulation thread, along with any requested exports
+    void Start();
+
+    // Read the OSM data file for a map name (in the data dir), empty if it couldn't be read
+    static std::vector<std::byte> ReadMapData(const std::string &map);
+
+  private:
+    // Member variables
+    std::unordered_map<std::string, std::string> settings_;
+    RouteModel model_;
+    RoadGraph road_graph_; // Note: after model_, which it is built from
+    std::shared_ptr<RoutePlanner> route_planner_;
+    std::shared_ptr<VehicleManager> vehicles_;
+    std::shared_ptr<PassengerQueue> passengers_;
+    std::shared_ptr<ZoneRouter> zone_router_;
+    std::shared_ptr<Metrics> metrics_;
+    std::shared_ptr<Rebalancer> rebalancer_;
+    std::shared_ptr<Market> market_;
+    std::shared_ptr<SnapshotStreamer> streamer_;
+    std::shared_ptr<RingPublisher> ring_publisher_;
+};
+
+}  // namespace rideshare
+
+#endif  // SIMULATION_H_
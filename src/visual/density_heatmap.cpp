@@ -0,0 +1,83 @@
+/**
+ * @file density_heatmap.cpp
+ * @brief Implementation of parallel density accumulation and color-mapping of the heatmap.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "density_heatmap.h"
+
+#include <algorithm>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace rideshare {
+
+DensityHeatmap::DensityHeatmap(cv::Size image_size, int cell_size) : CELL_SIZE_(cell_size) {
+    cv::Size grid_size((image_size.width + cell_size - 1) / cell_size, (image_size.height + cell_size - 1) / cell_size);
+    // Allocate everything once, re-used each frame
+    int stripes = std::max(1, cv::getNumThreads());
+    for (int i = 0; i < stripes; ++i) {
+        partials_.emplace_back(grid_size, CV_32FC1);
+    }
+    density_.create(grid_size, CV_32FC1);
+    heat_.create(grid_size, CV_8UC1);
+    heat_color_.create(grid_size, CV_8UC3);
+    heat_full_.create(image_size, CV_8UC3);
+}
+
+void DensityHeatmap::Render(const std::vector<cv::Point> &points, const cv::Mat &background, cv::Mat &frame) {
+    Accumulate(points);
+
+    // Smooth so single agents show as a soft spot, then scale the densest cell to full intensity
+    cv::GaussianBlur(density_, density_, cv::Size(5, 5), 0);
+    double max_density = 0.0;
+    cv::minMaxLoc(density_, nullptr, &max_density);
+    double scale = (max_density > 0.0) ? 255.0 / max_density : 0.0;
+    density_.convertTo(heat_, CV_8U, scale);
+
+    // "Hot" maps zero density to black, so adding it leaves empty areas showing the plain background
+    cv::applyColorMap(heat_, heat_color_, cv::COLORMAP_HOT);
+    cv::resize(heat_color_, heat_full_, heat_full_.size(), 0, 0, cv::INTER_LINEAR);
+    cv::addWeighted(background, 1.0, heat_full_, OPACITY_, 0, frame);
+}
+
+void DensityHeatmap::Accumulate(const std::vector<cv::Point> &points) {
+    const int stripes = (int)partials_.size();
+    const int point_count = (int)points.size();
+
+    // Each stripe takes a contiguous range of points and its own partial buffer
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range &range) {
+        for (int stripe = range.start; stripe < range.end; ++stripe) {
+            cv::Mat &partial = partials_.at(stripe);
+            partial.setTo(cv::Scalar(0));
+            int begin = (int)((long)point_count * stripe / stripes);
+            int end = (int)((long)point_count * (stripe + 1) / stripes);
+            for (int i = begin; i < end; ++i) {
+                int col = points[i].x / CELL_SIZE_;
+                int row = points[i].y / CELL_SIZE_;
+                if (row >= 0 && row < partial.rows && col >= 0 && col < partial.cols) {
+                    partial.at<float>(row, col) += 1.0f;
+                }
+            }
+        }
+    });
+
+    // Sum the partials, split by rows so each row is written by a single thread
+    cv::parallel_for_(cv::Range(0, density_.rows), [&](const cv::Range &range) {
+        for (int row = range.start; row < range.end; ++row) {
+            float *sum = density_.ptr<float>(row);
+            std::copy(partials_.at(0).ptr<float>(row), partials_.at(0).ptr<float>(row) + density_.cols, sum);
+            for (int stripe = 1; stripe < stripes; ++stripe) {
+                const float *partial = partials_.at(stripe).ptr<float>(row);
+                for (int col = 0; col < density_.cols; ++col) {
+                    sum[col] += partial[col];
+                }
+            }
+        }
+    });
+}
+
+}  // namespace rideshare
@@ -0,0 +1,42 @@
+/**
+ * @file density_heatmap.h
+ * @brief Draw agent density as a color-mapped heatmap, used in place of markers for very large fleets.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef DENSITY_HEATMAP_H_
+#define DENSITY_HEATMAP_H_
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace rideshare {
+
+class DensityHeatmap {
+  public:
+    // Constructor / Destructor
+    // Density is accumulated on a grid of `cell_size` image pixels, then scaled up to `image_size`
+    DensityHeatmap(cv::Size image_size, int cell_size);
+
+    // Accumulate the given image positions and draw the result over the background into frame
+    void Render(const std::vector<cv::Point> &points, const cv::Mat &background, cv::Mat &frame);
+
+  private:
+    // Accumulate points into one partial buffer per stripe in parallel, then sum them into density_
+    void Accumulate(const std::vector<cv::Point> &points);
+
+    // Member variables
+    const int CELL_SIZE_;
+    const float OPACITY_ = 0.9; // strength of the heatmap added over the background
+    std::vector<cv::Mat> partials_; // per-stripe float density, so stripes never write the same cell
+    cv::Mat density_;    // summed float density at grid resolution
+    cv::Mat heat_;       // density scaled to 8-bit
+    cv::Mat heat_color_; // color-mapped density at grid resolution
+    cv::Mat heat_full_;  // color-mapped density at image resolution
+};
+
+}  // namespace rideshare
+
+#endif  // DENSITY_HEATMAP_H_
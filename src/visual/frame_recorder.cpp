@@ -0,0 +1,124 @@
+/**
+ * @file frame_recorder.cpp
+ * @brief Implementation of the bounded frame queue and encoder thread for recording.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "frame_recorder.h"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+namespace rideshare {
+
+static bool EndsWith(const std::string &str, const std::string &suffix) {
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+FrameRecorder::FrameRecorder(std::string output_path, int frames_per_second, int queue_capacity) :
+                             OUTPUT_PATH_(output_path), IMAGE_SEQUENCE_(EndsWith(output_path, ".png")),
+                             FRAME_PERIOD_(1.0 / frames_per_second), QUEUE_CAPACITY_(queue_capacity) {}
+
+void FrameRecorder::Simulate() {
+    // Launch Encode function in a thread
+    threads.emplace_back(std::thread(&FrameRecorder::Encode, this));
+}
+
+void FrameRecorder::OfferFrame(const cv::Mat &frame, double sim_time) {
+    // Skip frames rendered between recording slots
+    if (sim_time < next_frame_time_) {
+        return;
+    }
+    // Cover every slot passed since the last recorded frame, so the output keeps to simulation time
+    int repeats = 1 + (int)std::floor((sim_time - next_frame_time_) / FRAME_PERIOD_);
+    next_frame_time_ += repeats * FRAME_PERIOD_;
+
+    // Grab a free buffer, or drop the frame if the encoder has fallen behind
+    std::unique_lock<std::mutex> lck(queue_mutex_);
+    if (buffers_.empty()) {
+        // First frame, so now know the size to allocate all buffers at
+        for (int i = 0; i < QUEUE_CAPACITY_; ++i) {
+            buffers_.emplace_back(frame.size(), frame.type());
+            free_buffers_.emplace_back(i);
+        }
+    }
+    if (free_buffers_.empty()) {
+        lck.unlock();
+        if (metrics_ != nullptr) {
+            metrics_->Increment("frames_dropped", repeats);
+        }
+        return;
+    }
+    int buffer = free_buffers_.back();
+    free_buffers_.pop_back();
+    lck.unlock();
+
+    // Copy outside of the lock; the buffer is owned by this thread until queued
+    frame.copyTo(buffers_.at(buffer));
+
+    lck.lock();
+    queued_.push_back({ .buffer = buffer, .repeats = repeats });
+    lck.unlock();
+    queue_cond_.notify_one();
+}
+
+void FrameRecorder::Encode() {
+    while (true) {
+        // Wait for the next queued frame
+        std::unique_lock<std::mutex> lck(queue_mutex_);
+        queue_cond_.wait(lck, [this] { return !queued_.empty(); });
+        QueuedFrame queued = queued_.front();
+        queued_.pop_front();
+        lck.unlock();
+
+        // Write without holding the lock so the render thread can keep queueing
+        for (int i = 0; i < queued.repeats; ++i) {
+            WriteFrame(buffers_.at(queued.buffer));
+        }
+        if (metrics_ != nullptr) {
+            metrics_->Increment("frames_recorded", queued.repeats);
+        }
+
+        // Return the buffer for re-use
+        lck.lock();
+        free_buffers_.emplace_back(queued.buffer);
+    }
+}
+
+void FrameRecorder::WriteFrame(const cv::Mat &frame) {
+    ++frame_count_;
+    if (IMAGE_SEQUENCE_) {
+        // e.g. "out.png" is written as "out_000001.png", "out_000002.png", ...
+        char number[16];
+        std::snprintf(number, sizeof(number), "_%06ld", frame_count_);
+        std::string filename = OUTPUT_PATH_.substr(0, OUTPUT_PATH_.size() - 4) + number + ".png";
+        cv::imwrite(filename, frame);
+        return;
+    }
+    if (writer_failed_) {
+        return;
+    }
+    if (!writer_.isOpened()) {
+        // Open on first write, now that the frame size is known
+        int fourcc = EndsWith(OUTPUT_PATH_, ".mp4") ? cv::VideoWriter::fourcc('m', 'p', '4', 'v')
+                                                    : cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        if (!writer_.open(OUTPUT_PATH_, fourcc, 1.0 / FRAME_PERIOD_, frame.size())) {
+            writer_failed_ = true;
+            std::lock_guard<std::mutex> lck(mtx_);
+            std::cout << "Unable to open video output: " << OUTPUT_PATH_ << std::endl;
+            return;
+        }
+    }
+    writer_.write(frame);
+}
+
+}  // namespace rideshare
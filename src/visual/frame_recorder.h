@@ -0,0 +1,73 @@
+/**
+ * @file frame_recorder.h
+ * @brief Record rendered frames to a video file or numbered images on a separate encoder thread.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef FRAME_RECORDER_H_
+#define FRAME_RECORDER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "concurrent/concurrent_object.h"
+#include "metrics/metrics.h"
+
+namespace rideshare {
+
+class FrameRecorder : public ConcurrentObject {
+  public:
+    // Constructor / Destructor
+    // An output ending in ".png" is written as numbered images, anything else through cv::VideoWriter
+    FrameRecorder(std::string output_path, int frames_per_second, int queue_capacity);
+
+    // Setters
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+
+    // Concurrent simulation
+    void Simulate();
+
+    // Offer a rendered frame at the given simulation time (seconds). Only frames due at the
+    //  recording frame rate are copied; if the queue is full the frame is dropped rather than waiting
+    void OfferFrame(const cv::Mat &frame, double sim_time);
+
+  private:
+    // A queued frame buffer, written once per frame rate slot it covers
+    struct QueuedFrame {
+        int buffer;
+        int repeats;
+    };
+
+    // Handles loop cycle of waiting for queued frames and writing them out
+    void Encode();
+    // Write a single frame to the video or as the next numbered image
+    void WriteFrame(const cv::Mat &frame);
+
+    // Member variables
+    const std::string OUTPUT_PATH_;
+    const bool IMAGE_SEQUENCE_; // numbered images instead of a video file
+    const double FRAME_PERIOD_; // seconds of simulation time between recorded frames
+    const int QUEUE_CAPACITY_;  // max frames waiting on the encoder before dropping
+    double next_frame_time_ = 0.0; // simulation time the next frame is due (render thread only)
+    long frame_count_ = 0;         // frames written so far (encoder thread only)
+    cv::VideoWriter writer_;
+    bool writer_failed_ = false;   // video output could not be opened, so stop trying
+    std::vector<cv::Mat> buffers_;     // frame buffers, allocated on the first offered frame
+    std::vector<int> free_buffers_;    // indices into buffers_ not currently queued
+    std::deque<QueuedFrame> queued_;   // frames waiting to be written, in order
+    std::mutex queue_mutex_;           // protect free_buffers_ and queued_
+    std::condition_variable queue_cond_;
+    std::shared_ptr<Metrics> metrics_;
+};
+
+}  // namespace rideshare
+
+#endif  // FRAME_RECORDER_H_
@@ -9,17 +9,42 @@
 
 #include "graphics.h"
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <thread>
+#include <utility>
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 
+#include "concurrent/agent_snapshot.h"
+#include "map_object/vehicle.h"
 #include "mapping/coordinate.h"
+#include "mapping/model.h"
 
 namespace rideshare {
 
+// Route color by what the vehicle is driving to, in BGR
+static const cv::Scalar ROUTE_COLORS[] = {
+    cv::Scalar(160, 160, 160), // no passenger
+    cv::Scalar(0, 165, 255),   // to pick up a passenger
+    cv::Scalar(60, 170, 60),   // to drop off a passenger
+};
+static const int ROUTE_BUCKETS = sizeof(ROUTE_COLORS) / sizeof(ROUTE_COLORS[0]);
+
+static int RouteBucketFor(const AgentState &vehicle) {
+    switch (vehicle.state) {
+        case VehicleState::passenger_queued:
+        case VehicleState::waiting:
+            return 1;
+        case VehicleState::driving_passenger:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
 Graphics::Graphics(float min_lat, float min_lon, float max_lat, float max_lon) {
     min_lat_ = min_lat;
     min_lon_ = min_lon;
@@ -29,6 +54,7 @@ Graphics::Graphics(float min_lat, float min_lon, float max_lat, float max_lon) {
 
 void Graphics::Simulate() {
     this->LoadBackgroundImg();
+    sim_start_ = std::chrono::steady_clock::now();
     while (true) {
         // sleep at every iteration to reduce CPU usage
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -39,85 +65,341 @@ void Graphics::Simulate() {
 }
 
 void Graphics::LoadBackgroundImg() {
-    // create window
+    // create window, unless only drawing offscreen
     windowName_ = "Rideshare Simulation";
-    cv::namedWindow(windowName_, cv::WINDOW_NORMAL);
+    if (display_) {
+        cv::namedWindow(windowName_, cv::WINDOW_NORMAL);
+    }
 
-    // load image and create copy to be used for semi-transparent overlay
-    cv::Mat background = cv::imread(bgFilename_);
-    images_.push_back(background);         // first element is the original background
-    images_.push_back(background.clone()); // second element will be the transparent overlay
-    images_.push_back(background.clone()); // third element will be the result image for display
+    // load image and allocate the viewport, overlay and display buffers once, up front
+    map_image_ = cv::imread(bgFilename_);
+    if (show_roads_ && model_ != nullptr) {
+        road_layer_ = std::make_unique<RoadLayer>(*model_, map_image_);
+    }
+    background_ = BaseImage().clone();
+    overlay_ = map_image_.clone();
+    frame_ = map_image_.clone();
+    heatmap_ = std::make_unique<DensityHeatmap>(map_image_.size(), HEATMAP_CELL_SIZE_);
+    projection_ = std::make_unique<Projection>(min_lat_, min_lon_, max_lat_, max_lon_, map_image_.size());
+    if (show_routes_ && model_ != nullptr) {
+        route_buckets_.resize(ROUTE_BUCKETS);
+        UpdateNodePixels();
+    } else {
+        show_routes_ = false;
+    }
 }
 
 void Graphics::DrawSimulation() {
-    // reset images
-    images_.at(1) = images_.at(0).clone();
-    images_.at(2) = images_.at(0).clone();
+    auto frame_start = std::chrono::steady_clock::now();
+
+    // pick up the latest published state, and where each agent should appear right now
+    UpdateSnapshots();
+    InterpolateAgents(frame_start);
+
+    ProjectAgents();
+    if (road_layer_ != nullptr) {
+        UpdateRoadLayer();
+    }
 
-    // Get image rows and columns to help with coordinate adjustments for image
-    float img_rows = images_.at(0).rows;
-    float img_cols = images_.at(0).cols;
+    // reset only the areas drawn on last frame
+    ResetDirtyRects();
 
-    DrawPassengers(img_rows, img_cols);
-    DrawVehicles(img_rows, img_cols);
+    if (UseHeatmap()) {
+        // too many agents in view for individual markers to be readable (or fast)
+        DrawDensity();
+        heatmap_last_frame_ = true;
+    } else {
+        if (heatmap_last_frame_) {
+            // heatmap covered the whole image, not just dirty areas
+            background_.copyTo(frame_);
+            heatmap_last_frame_ = false;
+        }
+        // routes first, so markers are drawn on top of them
+        if (show_routes_) {
+            DrawRoutes();
+        }
+        DrawAgents();
+
+        // single blend pass, limited to where markers were drawn
+        BlendDirtyRects();
+    }
 
     // display background and overlay image
-    cv::imshow(windowName_, images_.at(2));
-    cv::waitKey(33);
+    if (display_) {
+        cv::imshow(windowName_, frame_);
+    }
+
+    // hand off to the recorder, which drops the frame rather than waiting if it is behind
+    if (recorder_ != nullptr) {
+        std::chrono::duration<double> sim_time = frame_start - sim_start_;
+        recorder_->OfferFrame(frame_, sim_time.count());
+    }
+
+    if (metrics_ != nullptr) {
+        std::chrono::duration<double, std::milli> frame_time = std::chrono::steady_clock::now() - frame_start;
+        metrics_->Record("frame_ms", frame_time.count());
+    }
+
+    if (display_) {
+        if (HandleKey(cv::waitKey(33))) {
+            UpdateViewBackground();
+        }
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(33));
+    }
+}
+
+static bool CompareAgents(const AgentState &agent1, const AgentState &agent2) {
+    return (agent1.id < agent2.id) || (agent1.id == agent2.id && agent1.kind < agent2.kind);
+}
+
+void Graphics::UpdateSnapshots() {
+    for (SnapshotSource &source : sources_) {
+        // Only copy if there is something newer than what is already held
+        source.incoming.tick = source.latest.tick;
+        if (!source.snapshots->Read(source.incoming)) {
+            continue;
+        }
+        // Sort once per new snapshot, so interpolation can match agents with a single merge pass
+        std::sort(source.incoming.agents.begin(), source.incoming.agents.end(), CompareAgents);
+        // Rotate storage: latest becomes previous, and the oldest is re-used for the next read
+        std::swap(source.previous, source.latest);
+        std::swap(source.latest, source.incoming);
+    }
+}
+
+void Graphics::InterpolateAgents(std::chrono::steady_clock::time_point now) {
+    render_agents_.clear();
+    render_path_nodes_.clear();
+    for (const SnapshotSource &source : sources_) {
+        // Draw one tick behind, moving from the previous toward the latest position over a tick's time
+        double alpha = 1.0;
+        if (source.previous.tick != 0) {
+            std::chrono::duration<double> tick_time = source.latest.time - source.previous.time;
+            std::chrono::duration<double> since_latest = now - source.latest.time;
+            if (tick_time.count() > 0.0) {
+                alpha = std::min(1.0, since_latest.count() / tick_time.count());
+            }
+        }
+
+        auto prev_agent = source.previous.agents.begin();
+        for (const AgentState &agent : source.latest.agents) {
+            render_agents_.emplace_back(agent);
+            if (agent.path_count > 0) {
+                // Paths index into their own snapshot, so gather them into one vector across sources
+                render_agents_.back().path_offset = (int)render_path_nodes_.size();
+                auto path_start = source.latest.path_nodes.begin() + agent.path_offset;
+                render_path_nodes_.insert(render_path_nodes_.end(), path_start, path_start + agent.path_count);
+            }
+            // Both snapshots are sorted, so advance to where this agent would be in the previous one
+            while (prev_agent != source.previous.agents.end() && CompareAgents(*prev_agent, agent)) {
+                ++prev_agent;
+            }
+            if (prev_agent == source.previous.agents.end() || CompareAgents(agent, *prev_agent)) {
+                continue; // new this tick, so nothing to move from
+            }
+            Coordinate &position = render_agents_.back().position;
+            position.x = prev_agent->position.x + ((agent.position.x - prev_agent->position.x) * alpha);
+            position.y = prev_agent->position.y + ((agent.position.y - prev_agent->position.y) * alpha);
+        }
+    }
+}
+
+void Graphics::ProjectAgents() {
+    projection_->Project(render_agents_, agent_pixels_, dest_pixels_);
+    visible_agents_ = 0;
+    for (size_t i = 0; i < render_agents_.size(); ++i) {
+        if (render_agents_[i].kind != AgentKind::riding_passenger && projection_->Visible(agent_pixels_[i], 0)) {
+            ++visible_agents_;
+        }
+    }
+}
+
+void Graphics::DrawAgents() {
+    // create overlay from all agents, skipping any markers that would be entirely off the image
+    for (size_t i = 0; i < render_agents_.size(); ++i) {
+        const AgentState &agent = render_agents_[i];
+        cv::Scalar color = cv::Scalar(agent.blue, agent.green, agent.red);
+        if (agent.kind == AgentKind::vehicle_agent) {
+            if (projection_->Visible(agent_pixels_[i], MARKER_MARGIN_)) {
+                DrawMarker(agent_pixels_[i], color, agent.shape, 25, 15);
+            }
+            continue;
+        }
+        // Passengers use a full size marker while waiting, smaller when walking or in a vehicle,
+        //  and always a full size destination marker
+        if (projection_->Visible(agent_pixels_[i], MARKER_MARGIN_)) {
+            int marker_size = (agent.kind == AgentKind::waiting_passenger) ? 25 : 15;
+            DrawMarker(agent_pixels_[i], color, agent.shape, marker_size, 15);
+        }
+        if (projection_->Visible(dest_pixels_[i], MARKER_MARGIN_)) {
+            DrawMarker(dest_pixels_[i], color, agent.dest_shape, 25, 5);
+        }
+    }
 }
 
-void Graphics::DrawPassengers(float img_rows, float img_cols) {
-    // create overlay from passengers
-    for (auto const& passenger_map : passenger_queue_->NewPassengers()) {
-        DrawPassenger(img_rows, img_cols, 25, passenger_map.second); // Full size marker when waiting
+void Graphics::DrawRoutes() {
+    for (RouteBucket &bucket : route_buckets_) {
+        bucket.points.clear();
+        bucket.starts.clear();
+        bucket.counts.clear();
     }
-    for (auto const& walking_passenger : passenger_queue_->WalkingPassengers()) {
-        DrawPassenger(img_rows, img_cols, 15, walking_passenger.second); // Smaller marker when walking
+
+    // Build each route from projected node pixels, starting at the vehicle's drawn position
+    const cv::Rect image_area(0, 0, overlay_.cols, overlay_.rows);
+    for (size_t i = 0; i < render_agents_.size(); ++i) {
+        const AgentState &agent = render_agents_[i];
+        if (agent.kind != AgentKind::vehicle_agent || agent.path_count == 0) {
+            continue;
+        }
+        RouteBucket &bucket = route_buckets_[RouteBucketFor(agent)];
+        int start = (int)bucket.points.size();
+        cv::Point low = agent_pixels_[i], high = agent_pixels_[i];
+        bucket.points.emplace_back(agent_pixels_[i]);
+        for (int n = agent.path_offset; n < agent.path_offset + agent.path_count; ++n) {
+            const cv::Point &pixel = node_pixels_[render_path_nodes_[n]];
+            low.x = std::min(low.x, pixel.x);
+            low.y = std::min(low.y, pixel.y);
+            high.x = std::max(high.x, pixel.x);
+            high.y = std::max(high.y, pixel.y);
+            bucket.points.emplace_back(pixel);
+        }
+        // Skip routes entirely out of view, otherwise track the area they touch to blend
+        cv::Rect area(low.x - ROUTE_THICKNESS_, low.y - ROUTE_THICKNESS_,
+                      high.x - low.x + (2 * ROUTE_THICKNESS_) + 1, high.y - low.y + (2 * ROUTE_THICKNESS_) + 1);
+        area &= image_area;
+        if (area.empty()) {
+            bucket.points.resize(start);
+            continue;
+        }
+        bucket.starts.emplace_back(start);
+        bucket.counts.emplace_back((int)bucket.points.size() - start);
+        dirty_rects_.emplace_back(area);
     }
 
-    float opacity = 0.85;
-    cv::addWeighted(images_.at(1), opacity, images_.at(0), 1.0 - opacity, 0, images_.at(2));
+    // Pointers are only taken once each bucket is complete, as adding points may re-allocate
+    for (int b = 0; b < ROUTE_BUCKETS; ++b) {
+        RouteBucket &bucket = route_buckets_[b];
+        if (bucket.counts.empty()) {
+            continue;
+        }
+        bucket.polylines.clear();
+        for (int start : bucket.starts) {
+            bucket.polylines.emplace_back(bucket.points.data() + start);
+        }
+        cv::polylines(overlay_, bucket.polylines.data(), bucket.counts.data(), (int)bucket.counts.size(), false,
+                      ROUTE_COLORS[b], ROUTE_THICKNESS_, cv::LINE_AA);
+    }
 }
 
-void Graphics::DrawPassenger(float img_rows, float img_cols, int marker_size, const std::shared_ptr<Passenger> &passenger) {
-        Coordinate curr_position = passenger->GetPosition();
-        Coordinate dest_position = passenger->GetDestination();
+void Graphics::UpdateNodePixels() {
+    const std::vector<Model::Node> &nodes = model_->Nodes();
+    node_pixels_.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        node_pixels_[i] = projection_->Project({ .x = nodes[i].x, .y = nodes[i].y });
+    }
+}
 
-        // Adjust the position based on lat & lon in image
-        curr_position.x = (curr_position.x - min_lon_) / (max_lon_ - min_lon_);
-        curr_position.y = (max_lat_ - curr_position.y) / (max_lat_ - min_lat_);
-        dest_position.x = (dest_position.x - min_lon_) / (max_lon_ - min_lon_);
-        dest_position.y = (max_lat_ - dest_position.y) / (max_lat_ - min_lat_);
+void Graphics::DrawDensity() {
+    // Gather agents' image positions; passengers in vehicles share the vehicle position, so skip them
+    agent_points_.clear();
+    for (size_t i = 0; i < render_agents_.size(); ++i) {
+        if (render_agents_[i].kind != AgentKind::riding_passenger) {
+            agent_points_.emplace_back(agent_pixels_[i]);
+        }
+    }
 
-        // Draw both current position (size based on if in vehicle or not) and destination (always full-size)
-        cv::Scalar color = cv::Scalar(passenger->Blue(), passenger->Green(), passenger->Red());
-        cv::drawMarker(images_.at(1), cv::Point2d((int)(curr_position.x * img_cols), (int)(curr_position.y * img_rows)), color, passenger->PassShape(), marker_size, 15);
-        cv::drawMarker(images_.at(1), cv::Point2d((int)(dest_position.x * img_cols), (int)(dest_position.y * img_rows)), color, passenger->DestShape(), 25, 5);
+    heatmap_->Render(agent_points_, background_, frame_);
 }
 
-void Graphics::DrawVehicles(float img_rows, float img_cols) {
-    // create overlay from vehicles
-    for (auto const & [id, vehicle] : vehicle_manager_->Vehicles()) {
-        Coordinate position = vehicle->GetPosition();
+bool Graphics::UseHeatmap() const {
+    // Agents in view per megapixel of the screen. Markers stay the same size on screen, so zooming in on a crowded
+    //  area brings them back only because fewer agents are then in view
+    double screen_megapixels = frame_.total() / 1e6;
+    return visible_agents_ > 0 && visible_agents_ / screen_megapixels >= HEATMAP_AGENTS_PER_MEGAPIXEL_;
+}
 
-        // Adjust the position based on lat & lon in image
-        position.x = (position.x - min_lon_) / (max_lon_ - min_lon_);
-        position.y = (max_lat_ - position.y) / (max_lat_ - min_lat_);
+bool Graphics::HandleKey(int key) {
+    switch (key) {
+        case '+':
+        case '=':
+            return projection_->ZoomBy(1.25);
+        case '-':
+            return projection_->ZoomBy(0.8);
+        case 'w':
+            return projection_->Pan(0.0, -0.1);
+        case 's':
+            return projection_->Pan(0.0, 0.1);
+        case 'a':
+            return projection_->Pan(-0.1, 0.0);
+        case 'd':
+            return projection_->Pan(0.1, 0.0);
+        case '0':
+            return projection_->ShowAll();
+        default:
+            return false;
+    }
+}
 
-        // Set color according to vehicle and draw a marker there
-        cv::Scalar color = cv::Scalar(vehicle->Blue(), vehicle->Green(), vehicle->Red());
-        cv::drawMarker(images_.at(1), cv::Point2d((int)(position.x * img_cols), (int)(position.y * img_rows)), color, vehicle->Shape(), 25, 15);
-        // Draw any related information for possible passenger
-        auto passenger = vehicle->GetPassenger(); // ensures shared pointer will stay alive while drawing, if it exits
-        if (passenger != nullptr) {
-            // Note that this state is guaranteed to have a passenger
-            DrawPassenger(img_rows, img_cols, 15, passenger); // Smaller marker
+void Graphics::UpdateViewBackground() {
+    // Only done when the viewport changes, so the per-frame cost doesn't include scaling the map
+    cv::resize(BaseImage()(projection_->Viewport()), background_, background_.size(), 0, 0, cv::INTER_LINEAR);
+    background_.copyTo(overlay_);
+    background_.copyTo(frame_);
+    prev_dirty_rects_.clear();
+    heatmap_last_frame_ = false;
+    if (show_routes_) {
+        UpdateNodePixels();
+    }
+}
+
+void Graphics::UpdateRoadLayer() {
+    road_changes_.clear();
+    road_layer_->UpdateCongestion(render_agents_, road_changes_);
+    for (const cv::Rect &area : road_changes_) {
+        // Only the part of each re-drawn area within view needs scaling onto the background
+        cv::Rect map_area = area & projection_->Viewport();
+        if (map_area.empty()) {
+            continue;
+        }
+        cv::Rect view_area = projection_->MapAreaToOutput(map_area);
+        if (view_area.empty()) {
+            continue;
         }
+        cv::resize(road_layer_->Composed()(map_area), background_(view_area), view_area.size(), 0, 0, cv::INTER_LINEAR);
+        // Reset the overlay and display image there too, along with last frame's marker areas
+        prev_dirty_rects_.emplace_back(view_area);
     }
+}
+
+void Graphics::DrawMarker(const cv::Point &position, const cv::Scalar &color, int shape, int marker_size, int thickness) {
+    // Thick lines extend past the marker size, so pad the touched area by the thickness
+    int half_extent = (marker_size / 2) + thickness;
+    cv::Rect area(position.x - half_extent, position.y - half_extent, (2 * half_extent) + 1, (2 * half_extent) + 1);
+    area &= cv::Rect(0, 0, overlay_.cols, overlay_.rows);
+    if (area.empty()) {
+        return; // off the image entirely
+    }
+    cv::drawMarker(overlay_, position, color, shape, marker_size, thickness);
+    dirty_rects_.emplace_back(area);
+}
 
-    float opacity = 0.85;
-    cv::addWeighted(images_.at(1), opacity, images_.at(0), 1.0 - opacity, 0, images_.at(2));
+void Graphics::ResetDirtyRects() {
+    // Overlapping areas are copied more than once, which is cheaper than merging them
+    for (const cv::Rect &area : prev_dirty_rects_) {
+        background_(area).copyTo(overlay_(area));
+        background_(area).copyTo(frame_(area));
+    }
+    prev_dirty_rects_.clear();
+}
+
+void Graphics::BlendDirtyRects() {
+    // Each blend reads only the overlay and background, so overlapping areas give the same result
+    for (const cv::Rect &area : dirty_rects_) {
+        cv::addWeighted(overlay_(area), OPACITY_, background_(area), 1.0 - OPACITY_, 0, frame_(area));
+    }
+    // Keep this frame's areas to reset next frame, re-using both vectors' capacity
+    std::swap(dirty_rects_, prev_dirty_rects_);
 }
 
 }  // namespace rideshare
@@ -10,14 +10,20 @@
 #ifndef GRAPHICS_H_
 #define GRAPHICS_H_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 #include <opencv2/core.hpp>
 
-#include "concurrent/passenger_queue.h"
-#include "concurrent/vehicle_manager.h"
-#include "map_object/passenger.h"
+#include "concurrent/agent_snapshot.h"
+#include "mapping/coordinate.h"
+#include "mapping/model.h"
+#include "metrics/metrics.h"
+#include "visual/density_heatmap.h"
+#include "visual/frame_recorder.h"
+#include "visual/projection.h"
+#include "visual/road_layer.h"
 
 namespace rideshare {
 
@@ -28,8 +34,18 @@ class Graphics {
 
     // Setters
     void SetBgFilename(std::string filename) { bgFilename_ = filename; }
-    void SetVehicles(const std::shared_ptr<VehicleManager> &vehicle_manager) { vehicle_manager_ = vehicle_manager; }
-    void SetPassengers(const std::shared_ptr<PassengerQueue> &passenger_queue) { passenger_queue_ = passenger_queue; }
+    // Add published snapshots to draw from (e.g. the vehicle manager's); live objects are never read
+    void AddSnapshotSource(SnapshotBuffer *snapshots) { sources_.emplace_back(); sources_.back().snapshots = snapshots; }
+    void SetMetrics(const std::shared_ptr<Metrics> &metrics) { metrics_ = metrics; }
+    void SetRecorder(const std::shared_ptr<FrameRecorder> &recorder) { recorder_ = recorder; }
+    // Without a display, frames are only drawn offscreen (e.g. for recording on a server)
+    void SetDisplay(bool display) { display_ = display; }
+    // Road model to draw the road network and vehicle routes from
+    void SetModel(const Model *model) { model_ = model; }
+    // Draw the model's road network, colored by congestion, over the map image
+    void SetShowRoads(bool show_roads) { show_roads_ = show_roads; }
+    // Draw the remaining path of each vehicle published with one
+    void SetShowRoutes(bool show_routes) { show_routes_ = show_routes; }
 
     // Concurrent drawing simulation
     void Simulate();
@@ -39,20 +55,92 @@ class Graphics {
     void LoadBackgroundImg();
     // Loop to draw desired objects on OSM tile
     void DrawSimulation();
-    // Draw waiting passengers onto the image
-    void DrawPassengers(float img_rows, float img_cols);
-    // Draw a single passenger (position and destination) on the image
-    void DrawPassenger(float img_rows, float img_cols, int marker_size, const std::shared_ptr<Passenger> &passenger);
-    // Draw all vehicles on the image
-    void DrawVehicles(float img_rows, float img_cols);
+    // Read any newly published snapshots, keeping the previous one of each to interpolate from
+    void UpdateSnapshots();
+    // Fill render_agents_ with positions interpolated between each source's previous and latest snapshots
+    void InterpolateAgents(std::chrono::steady_clock::time_point now);
+    // Convert all agents to image pixels in one pass, and count how many are within view
+    void ProjectAgents();
+    // Draw all agents within view as markers on the image
+    void DrawAgents();
+    // Draw vehicles' remaining paths as polylines, gathered into one draw call per color
+    void DrawRoutes();
+    // Convert every road node to image pixels, only needed when the viewport changes
+    void UpdateNodePixels();
+    // Draw the density of all vehicles and passengers as a heatmap, in place of individual markers
+    void DrawDensity();
+    // Whether agents in view are dense enough on screen to draw as a heatmap
+    bool UseHeatmap() const;
+    // Pan / zoom the viewport based on a pressed key, returning whether it changed
+    bool HandleKey(int key);
+    // Re-draw the background for the current viewport, and reset all buffers to it
+    void UpdateViewBackground();
+    // Re-color congestion on the road network, and re-draw only the changed areas of the background
+    void UpdateRoadLayer();
+    // Map image to draw the background from, including the road network if shown
+    const cv::Mat &BaseImage() const { return (road_layer_ != nullptr) ? road_layer_->Composed() : map_image_; }
+    // Draw a marker onto the overlay, and track the area it touched so only that area gets blended
+    void DrawMarker(const cv::Point &position, const cv::Scalar &color, int shape, int marker_size, int thickness);
+    // Restore the areas drawn on in the last frame back to the plain background
+    void ResetDirtyRects();
+    // Blend the overlay with the background, only within areas drawn on this frame
+    void BlendDirtyRects();
+
+    // Snapshots read from a single publisher, sorted by id so consecutive ones can be matched up
+    struct SnapshotSource {
+        SnapshotBuffer *snapshots;
+        AgentSnapshot incoming; // storage to read into, swapped in once read
+        AgentSnapshot previous;
+        AgentSnapshot latest;
+    };
 
     // Member variables
     float min_lat_, min_lon_, max_lat_, max_lon_;
-    std::shared_ptr<VehicleManager> vehicle_manager_;
-    std::shared_ptr<PassengerQueue> passenger_queue_;
+    std::vector<SnapshotSource> sources_;
+    std::vector<AgentState> render_agents_; // agents to draw this frame, at interpolated positions
+    std::shared_ptr<Metrics> metrics_;
+    std::shared_ptr<FrameRecorder> recorder_;
+    bool display_ = true;
+    std::chrono::steady_clock::time_point sim_start_; // simulation time is measured from here
     std::string bgFilename_;
     std::string windowName_;
-    std::vector<cv::Mat> images_;
+    // Frame buffers are allocated once when loading the background, and re-used every frame
+    cv::Mat map_image_;  // original, full map image
+    cv::Mat background_; // map image scaled to the current viewport
+    cv::Mat overlay_;    // background with markers drawn on, blended to make them semi-transparent
+    cv::Mat frame_;      // result image for display
+    std::vector<cv::Rect> dirty_rects_;      // areas of overlay_ drawn on this frame
+    std::vector<cv::Rect> prev_dirty_rects_; // areas drawn on last frame, to be reset
+    const float OPACITY_ = 0.85; // opacity of markers over the background
+    // Projection to image pixels, with scale and offset precomputed for the current viewport
+    std::unique_ptr<Projection> projection_;
+    std::vector<cv::Point> agent_pixels_; // image pixels of render_agents_ positions
+    std::vector<cv::Point> dest_pixels_;  // image pixels of render_agents_ destinations
+    size_t visible_agents_ = 0;           // agents (not in vehicles) within the viewport this frame
+    const int MARKER_MARGIN_ = 30;        // markers this far outside the image could still be partly seen
+    const Model *model_ = nullptr;
+    // Road network, rasterized once and then only re-drawn where congestion changes
+    bool show_roads_ = false;
+    std::unique_ptr<RoadLayer> road_layer_;
+    std::vector<cv::Rect> road_changes_; // areas of the map image re-drawn by the road layer this frame
+    // Level of detail - past a density of agents on screen, draw a density heatmap instead of markers
+    std::unique_ptr<DensityHeatmap> heatmap_;
+    std::vector<cv::Point> agent_points_; // image positions of agents, re-used each heatmap frame
+    bool heatmap_last_frame_ = false;     // last frame overwrote the whole display image
+    const double HEATMAP_AGENTS_PER_MEGAPIXEL_ = 100.0; // on screen, e.g. ~130 agents on the whole downtown-kc map
+    const int HEATMAP_CELL_SIZE_ = 4; // pixels per side of each heatmap density cell
+    // Vehicle routes, as polylines through road nodes projected once per viewport
+    struct RouteBucket {
+        std::vector<cv::Point> points;           // all polylines of one color, back to back
+        std::vector<int> starts;                 // index of each polyline's first point
+        std::vector<int> counts;                 // points in each polyline
+        std::vector<const cv::Point*> polylines; // first point of each, as cv::polylines takes them
+    };
+    bool show_routes_ = false;
+    std::vector<cv::Point> node_pixels_;   // image pixels of every road node, for the current viewport
+    std::vector<int> render_path_nodes_;   // remaining paths of render_agents_, at their path offsets
+    std::vector<RouteBucket> route_buckets_;
+    const int ROUTE_THICKNESS_ = 3;
 };
 
 }  // namespace rideshare
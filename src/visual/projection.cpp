@@ -0,0 +1,102 @@
+/**
+ * @file projection.cpp
+ * @brief Implementation of the precomputed lat & lon to pixel transform and viewport changes.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "projection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <opencv2/core.hpp>
+
+namespace rideshare {
+
+Projection::Projection(double min_lat, double min_lon, double max_lat, double max_lon, cv::Size map_size) :
+                       MIN_LAT_(min_lat), MIN_LON_(min_lon), MAX_LAT_(max_lat), MAX_LON_(max_lon),
+                       MAP_SIZE_(map_size), output_size_(map_size) {
+    SetViewport(cv::Rect(0, 0, map_size.width, map_size.height));
+}
+
+void Projection::SetViewport(const cv::Rect &viewport) {
+    viewport_ = viewport;
+    // Map image pixel = (lon - min_lon) * map pixels per degree, then output pixel = (that - viewport x) * zoom
+    double zoom_x = (double)output_size_.width / viewport_.width;
+    double zoom_y = (double)output_size_.height / viewport_.height;
+    double map_x_per_lon = MAP_SIZE_.width / (MAX_LON_ - MIN_LON_);
+    double map_y_per_lat = MAP_SIZE_.height / (MAX_LAT_ - MIN_LAT_);
+    scale_x_ = map_x_per_lon * zoom_x;
+    offset_x_ = -((MIN_LON_ * map_x_per_lon) + viewport_.x) * zoom_x;
+    // Latitude increases upward, while image rows increase downward
+    scale_y_ = -map_y_per_lat * zoom_y;
+    offset_y_ = ((MAX_LAT_ * map_y_per_lat) - viewport_.y) * zoom_y;
+}
+
+bool Projection::Pan(double fraction_x, double fraction_y) {
+    cv::Rect moved = viewport_;
+    moved.x = std::clamp(moved.x + (int)(fraction_x * moved.width), 0, MAP_SIZE_.width - moved.width);
+    moved.y = std::clamp(moved.y + (int)(fraction_y * moved.height), 0, MAP_SIZE_.height - moved.height);
+    if (moved == viewport_) {
+        return false;
+    }
+    SetViewport(moved);
+    return true;
+}
+
+bool Projection::ZoomBy(double factor) {
+    // Keep the output aspect ratio, and don't zoom in past a small fraction of the map
+    int width = std::clamp((int)std::lround(viewport_.width / factor), MAP_SIZE_.width / 16, MAP_SIZE_.width);
+    int height = (int)std::lround((double)width * output_size_.height / output_size_.width);
+    height = std::min(height, MAP_SIZE_.height);
+    int center_x = viewport_.x + (viewport_.width / 2);
+    int center_y = viewport_.y + (viewport_.height / 2);
+    cv::Rect zoomed(std::clamp(center_x - (width / 2), 0, MAP_SIZE_.width - width),
+                    std::clamp(center_y - (height / 2), 0, MAP_SIZE_.height - height), width, height);
+    if (zoomed == viewport_) {
+        return false;
+    }
+    SetViewport(zoomed);
+    return true;
+}
+
+bool Projection::ShowAll() {
+    cv::Rect whole_map(0, 0, MAP_SIZE_.width, MAP_SIZE_.height);
+    if (whole_map == viewport_) {
+        return false;
+    }
+    SetViewport(whole_map);
+    return true;
+}
+
+cv::Rect Projection::MapAreaToOutput(const cv::Rect &area) const {
+    double zoom_x = (double)output_size_.width / viewport_.width;
+    double zoom_y = (double)output_size_.height / viewport_.height;
+    // Round outward so the output area fully covers the map area
+    int left = (int)std::floor((area.x - viewport_.x) * zoom_x);
+    int top = (int)std::floor((area.y - viewport_.y) * zoom_y);
+    int right = (int)std::ceil((area.x + area.width - viewport_.x) * zoom_x);
+    int bottom = (int)std::ceil((area.y + area.height - viewport_.y) * zoom_y);
+    return cv::Rect(left, top, right - left, bottom - top) & cv::Rect(0, 0, output_size_.width, output_size_.height);
+}
+
+void Projection::Project(const std::vector<AgentState> &agents, std::vector<cv::Point> &positions,
+                         std::vector<cv::Point> &destinations) const {
+    const size_t count = agents.size();
+    positions.resize(count);
+    destinations.resize(count);
+    // Copy the transform locally so the loops only touch the agents and outputs
+    const double scale_x = scale_x_, offset_x = offset_x_, scale_y = scale_y_, offset_y = offset_y_;
+    for (size_t i = 0; i < count; ++i) {
+        positions[i].x = (int)((agents[i].position.x * scale_x) + offset_x);
+        positions[i].y = (int)((agents[i].position.y * scale_y) + offset_y);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        destinations[i].x = (int)((agents[i].destination.x * scale_x) + offset_x);
+        destinations[i].y = (int)((agents[i].destination.y * scale_y) + offset_y);
+    }
+}
+
+}  // namespace rideshare
@@ -0,0 +1,70 @@
+/**
+ * @file projection.h
+ * @brief Convert lat & lon positions to output image pixels for a pan / zoom viewport of the map image.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef PROJECTION_H_
+#define PROJECTION_H_
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "concurrent/agent_snapshot.h"
+#include "mapping/coordinate.h"
+
+namespace rideshare {
+
+class Projection {
+  public:
+    // Constructor / Destructor
+    // Starts showing the whole map image of `map_size` at the same size
+    Projection(double min_lat, double min_lon, double max_lat, double max_lon, cv::Size map_size);
+
+    // Getters / Setters
+    // Area of the map image (in map image pixels) currently shown
+    const cv::Rect &Viewport() const { return viewport_; }
+    // Output image pixels per map image pixel
+    double Zoom() const { return (double)output_size_.width / viewport_.width; }
+    // Show the given area of the map image across the whole output; precomputes the scale and offset
+    void SetViewport(const cv::Rect &viewport);
+
+    // Viewport changes, kept within the map. Each returns whether the viewport changed
+    // Move by a fraction of the current viewport size
+    bool Pan(double fraction_x, double fraction_y);
+    // Zoom in (factor > 1) or out around the viewport center, no further out than the whole map
+    bool ZoomBy(double factor);
+    // Zoom back out to the whole map
+    bool ShowAll();
+
+    // Projection
+    // Convert every agent's position and destination to output pixels in one pass each
+    void Project(const std::vector<AgentState> &agents, std::vector<cv::Point> &positions,
+                 std::vector<cv::Point> &destinations) const;
+    // Convert a single position to output pixels
+    cv::Point Project(const Coordinate &position) const {
+        return cv::Point((int)((position.x * scale_x_) + offset_x_), (int)((position.y * scale_y_) + offset_y_));
+    }
+    // Convert an area of the map image (in map image pixels) to the output pixels covering it, within the output
+    cv::Rect MapAreaToOutput(const cv::Rect &area) const;
+    // Whether anything drawn within `margin` pixels of the given output pixel would be seen
+    bool Visible(const cv::Point &pixel, int margin) const {
+        return pixel.x >= -margin && pixel.y >= -margin &&
+               pixel.x < output_size_.width + margin && pixel.y < output_size_.height + margin;
+    }
+
+  private:
+    // Member variables
+    const double MIN_LAT_, MIN_LON_, MAX_LAT_, MAX_LON_;
+    const cv::Size MAP_SIZE_;
+    cv::Size output_size_;
+    cv::Rect viewport_;
+    // lon * scale_x_ + offset_x_ gives the output column, and lat * scale_y_ + offset_y_ the row
+    double scale_x_, offset_x_, scale_y_, offset_y_;
+};
+
+}  // namespace rideshare
+
+#endif  // PROJECTION_H_
@@ -0,0 +1,125 @@
+/**
+ * @file road_layer.cpp
+ * @brief Implementation of rasterizing the road network once and incrementally re-coloring congestion.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#include "road_layer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "mapping/coordinate.h"
+#include "visual/projection.h"
+
+namespace rideshare {
+
+// Road colors (BGR) by number of vehicles on a segment, with the last used for any higher count
+static const cv::Scalar CONGESTION_COLORS[] = {
+    cv::Scalar(160, 110, 70),  // empty
+    cv::Scalar(60, 180, 60),   // 1 vehicle
+    cv::Scalar(40, 200, 230),  // 2 vehicles
+    cv::Scalar(30, 130, 240),  // 3 vehicles
+    cv::Scalar(30, 30, 220),   // 4+ vehicles
+};
+static const int CONGESTION_LEVELS = sizeof(CONGESTION_COLORS) / sizeof(CONGESTION_COLORS[0]);
+
+RoadLayer::RoadLayer(const Model &model, const cv::Mat &map_image) : map_image_(map_image) {
+    // Project road nodes onto the whole map image
+    Projection projection(model.MinLat(), model.MinLon(), model.MaxLat(), model.MaxLon(), map_image.size());
+
+    // Collect each segment between consecutive nodes on a road once, whichever direction it is in
+    for (const Model::Road &road : model.Roads()) {
+        const std::vector<int> &way_nodes = model.Ways()[road.way].nodes;
+        for (size_t i = 1; i < way_nodes.size(); ++i) {
+            uint64_t key = EdgeKey(way_nodes[i - 1], way_nodes[i]);
+            if (edge_index_.count(key) == 1) {
+                continue;
+            }
+            const Model::Node &from = model.Nodes()[way_nodes[i - 1]];
+            const Model::Node &to = model.Nodes()[way_nodes[i]];
+            edge_index_.emplace(key, (int)edges_.size());
+            edges_.push_back({ .from = projection.Project({ .x = from.x, .y = from.y }),
+                               .to = projection.Project({ .x = to.x, .y = to.y }) });
+        }
+    }
+    counts_.assign(edges_.size(), 0);
+    next_counts_.assign(edges_.size(), 0);
+
+    // Rasterize the whole network once, then blend it over the map image in a single pass
+    layer_ = map_image_.clone();
+    for (const Edge &edge : edges_) {
+        cv::line(layer_, edge.from, edge.to, CONGESTION_COLORS[0], LINE_THICKNESS_, cv::LINE_AA);
+    }
+    cv::addWeighted(map_image_, 1.0 - OPACITY_, layer_, OPACITY_, 0, composed_);
+}
+
+uint64_t RoadLayer::EdgeKey(int node1, int node2) {
+    uint64_t low = (uint32_t)std::min(node1, node2);
+    uint64_t high = (uint32_t)std::max(node1, node2);
+    return (high << 32) | low;
+}
+
+void RoadLayer::UpdateCongestion(const std::vector<AgentState> &agents, std::vector<cv::Rect> &changed_areas) {
+    // Count vehicles per segment, only touching segments that have any
+    for (const AgentState &agent : agents) {
+        if (agent.kind != AgentKind::vehicle_agent || agent.edge_from < 0) {
+            continue;
+        }
+        auto found = edge_index_.find(EdgeKey(agent.edge_from, agent.edge_to));
+        if (found == edge_index_.end()) {
+            continue; // route step between nodes that aren't consecutive on a road
+        }
+        if (next_counts_[found->second]++ == 0) {
+            next_occupied_.emplace_back(found->second);
+        }
+    }
+
+    // Re-draw segments that are newly occupied or changed count...
+    for (int edge : next_occupied_) {
+        if (next_counts_[edge] != counts_[edge]) {
+            changed_areas.emplace_back(DrawEdge(edge, next_counts_[edge]));
+            counts_[edge] = next_counts_[edge];
+        }
+    }
+    // ...and those that have emptied out
+    for (int edge : occupied_) {
+        if (next_counts_[edge] == 0 && counts_[edge] != 0) {
+            changed_areas.emplace_back(DrawEdge(edge, 0));
+            counts_[edge] = 0;
+        }
+    }
+
+    // Clear this update's counts, and keep its occupied segments for comparison next time
+    for (int edge : next_occupied_) {
+        next_counts_[edge] = 0;
+    }
+    std::swap(occupied_, next_occupied_);
+    next_occupied_.clear();
+}
+
+cv::Rect RoadLayer::DrawEdge(int edge, int vehicle_count) {
+    const Edge &segment = edges_[edge];
+    const cv::Scalar &color = CONGESTION_COLORS[std::min(vehicle_count, CONGESTION_LEVELS - 1)];
+    cv::line(layer_, segment.from, segment.to, color, LINE_THICKNESS_, cv::LINE_AA);
+
+    // Blend just the area around the segment, padded for line thickness
+    cv::Rect area(segment.from, segment.to);
+    area.x -= LINE_THICKNESS_;
+    area.y -= LINE_THICKNESS_;
+    area.width += (2 * LINE_THICKNESS_) + 1;
+    area.height += (2 * LINE_THICKNESS_) + 1;
+    area &= cv::Rect(0, 0, map_image_.cols, map_image_.rows);
+    if (!area.empty()) {
+        cv::addWeighted(map_image_(area), 1.0 - OPACITY_, layer_(area), OPACITY_, 0, composed_(area));
+    }
+    return area;
+}
+
+}  // namespace rideshare
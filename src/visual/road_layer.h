@@ -0,0 +1,65 @@
+/**
+ * @file road_layer.h
+ * @brief Road network drawn once over the map image, with congestion coloring updated per changed road segment.
+ *
+ * @copyright Copyright (c) 2021, Michael Virgo, released under the MIT License.
+ *
+ */
+
+#ifndef ROAD_LAYER_H_
+#define ROAD_LAYER_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "concurrent/agent_snapshot.h"
+#include "mapping/model.h"
+
+namespace rideshare {
+
+class RoadLayer {
+  public:
+    // Constructor / Destructor
+    // Rasterizes every road segment of the model onto a copy of the map image
+    RoadLayer(const Model &model, const cv::Mat &map_image);
+
+    // Getters
+    // Map image with the road network and its congestion drawn on
+    const cv::Mat &Composed() const { return composed_; }
+
+    // Re-count vehicles on each road segment and re-draw only segments whose count changed.
+    //  Areas of the composed image (in map image pixels) that were re-drawn are added to changed_areas
+    void UpdateCongestion(const std::vector<AgentState> &agents, std::vector<cv::Rect> &changed_areas);
+
+  private:
+    // A single road segment between two consecutive nodes on a way
+    struct Edge {
+        cv::Point from;
+        cv::Point to;
+    };
+
+    // Key for a segment in either direction between two road nodes
+    static uint64_t EdgeKey(int node1, int node2);
+    // Draw a segment in the color for its vehicle count, and blend that area onto the map image.
+    //  Returns the area re-drawn
+    cv::Rect DrawEdge(int edge, int vehicle_count);
+
+    // Member variables
+    cv::Mat map_image_;
+    cv::Mat layer_;    // map image with the road network drawn fully opaque
+    cv::Mat composed_; // map image with the road network blended on
+    std::vector<Edge> edges_;
+    std::unordered_map<uint64_t, int> edge_index_; // EdgeKey -> index into edges_
+    std::vector<int> counts_;       // vehicles on each edge as currently drawn
+    std::vector<int> next_counts_;  // vehicles on each edge as of this update, all zero between updates
+    std::vector<int> occupied_;      // edges with vehicles as currently drawn
+    std::vector<int> next_occupied_; // edges with vehicles as of this update
+    const int LINE_THICKNESS_ = 3;
+    const float OPACITY_ = 0.6; // opacity of the road network over the map image
+};
+
+}  // namespace rideshare
+
+#endif  // ROAD_LAYER_H_